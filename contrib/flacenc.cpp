@@ -0,0 +1,486 @@
+#include "flacenc.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace flacenc {
+
+namespace {
+
+constexpr unsigned kMaxFixedOrder = 4;
+constexpr unsigned kMaxPartitionOrder = 8;
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+    // n <= 32, only the low n bits of v are written
+    void Put(uint32_t v, unsigned n) {
+        if (n == 0) return;
+        acc_ = (acc_ << n) | (v & ((uint64_t(1) << n) - 1));
+        bits_ += n;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(uint8_t(acc_ >> bits_));
+        }
+    }
+
+    void PutRice(uint32_t u, unsigned k) {
+        uint32_t q = u >> k;
+        while (q >= 32) {
+            Put(0, 32);
+            q -= 32;
+        }
+        Put(1, q + 1);
+        Put(u, k);
+    }
+
+    void Align() {
+        if (bits_) Put(0, 8 - bits_);
+    }
+
+private:
+    std::vector<uint8_t> &out_;
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+uint8_t Crc8(const uint8_t *d, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= d[i];
+        for (int b = 0; b < 8; ++b) crc = (crc & 0x80) ? uint8_t((crc << 1) ^ 0x07) : uint8_t(crc << 1);
+    }
+    return crc;
+}
+
+uint16_t Crc16(const uint8_t *d, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= uint16_t(d[i]) << 8;
+        for (int b = 0; b < 8; ++b) crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ 0x8005) : uint16_t(crc << 1);
+    }
+    return crc;
+}
+
+// partitioned Rice coding of one residual
+struct RicePlan {
+    unsigned order = 0;
+    bool rice2 = false;  // 5-bit parameters
+    unsigned k[1 << kMaxPartitionOrder];
+};
+
+// Picks the partition order and parameters for u[pred..n), returns the
+// estimated size in bits.
+uint64_t PlanRice(const uint32_t *u, unsigned n, unsigned pred, RicePlan *plan) {
+    unsigned pmax = 0;
+    while (pmax < kMaxPartitionOrder && (n % (2u << pmax)) == 0 && (n >> (pmax + 1)) > pred) ++pmax;
+
+    uint64_t sum[1 << kMaxPartitionOrder];
+    unsigned parts = 1u << pmax;
+    unsigned psize = n >> pmax;
+    for (unsigned j = 0, i = pred; j < parts; ++j) {
+        uint64_t s = 0;
+        for (unsigned end = (j + 1) * psize; i < end; ++i) s += u[i];
+        sum[j] = s;
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (unsigned p = pmax;; --p) {
+        parts = 1u << p;
+        psize = n >> p;
+        unsigned k[1 << kMaxPartitionOrder];
+        uint64_t bits = 2 + 4;
+        unsigned kmax = 0;
+        for (unsigned j = 0; j < parts; ++j) {
+            uint64_t m = psize - (j == 0 ? pred : 0);
+            unsigned kj = 0;
+            if (m > 0) {
+                while (kj < 30 && (m << (kj + 1)) <= sum[j]) ++kj;
+                bits += m * (kj + 1) + (sum[j] >> kj);
+            }
+            k[j] = kj;
+            if (kj > kmax) kmax = kj;
+        }
+        bits += uint64_t(parts) * (kmax > 14 ? 5 : 4);
+        if (bits < best) {
+            best = bits;
+            plan->order = p;
+            plan->rice2 = kmax > 14;
+            std::memcpy(plan->k, k, parts * sizeof(unsigned));
+        }
+        if (p == 0) break;
+        for (unsigned j = 0; j < parts / 2; ++j) sum[j] = sum[2 * j] + sum[2 * j + 1];
+    }
+    return best;
+}
+
+void FixedResidual(const int32_t *x, unsigned n, unsigned order, uint32_t *u) {
+    for (unsigned i = order; i < n; ++i) {
+        int64_t e;
+        switch (order) {
+        case 0: e = x[i]; break;
+        case 1: e = int64_t(x[i]) - x[i-1]; break;
+        case 2: e = int64_t(x[i]) - 2 * int64_t(x[i-1]) + x[i-2]; break;
+        case 3: e = int64_t(x[i]) - 3 * int64_t(x[i-1]) + 3 * int64_t(x[i-2]) - x[i-3]; break;
+        default: e = int64_t(x[i]) - 4 * int64_t(x[i-1]) + 6 * int64_t(x[i-2]) - 4 * int64_t(x[i-3]) + x[i-4]; break;
+        }
+        u[i] = uint32_t((e << 1) ^ (e >> 63));
+    }
+}
+
+// the cheapest coding of one channel of a block
+struct Subframe {
+    enum Type { kConstant, kVerbatim, kFixed } type = kVerbatim;
+    unsigned order = 0;
+    unsigned bps = 0;
+    const int32_t *x = nullptr;
+    uint64_t bits = 0;
+    RicePlan plan;
+    std::vector<uint32_t> u;
+
+    void Analyze(const int32_t *samples, unsigned n, unsigned sample_bits) {
+        x = samples;
+        bps = sample_bits;
+        type = kVerbatim;
+        bits = 8 + uint64_t(n) * bps;
+
+        bool constant = true;
+        for (unsigned i = 1; i < n && constant; ++i) constant = x[i] == x[0];
+        if (constant) {
+            type = kConstant;
+            bits = 8 + bps;
+            return;
+        }
+
+        u.resize(n);
+        std::vector<uint32_t> tmp(n);
+        RicePlan p;
+        for (unsigned o = 0; o <= kMaxFixedOrder && o < n; ++o) {
+            FixedResidual(x, n, o, tmp.data());
+            uint64_t b = 8 + uint64_t(o) * bps + PlanRice(tmp.data(), n, o, &p);
+            if (b < bits) {
+                bits = b;
+                type = kFixed;
+                order = o;
+                plan = p;
+                u.swap(tmp);
+            }
+        }
+    }
+
+    void Write(BitWriter &w, unsigned n) const {
+        switch (type) {
+        case kConstant:
+            w.Put(0x00 << 1, 8);
+            w.Put(uint32_t(x[0]), bps);
+            break;
+        case kVerbatim:
+            w.Put(0x01 << 1, 8);
+            for (unsigned i = 0; i < n; ++i) w.Put(uint32_t(x[i]), bps);
+            break;
+        case kFixed: {
+            w.Put((0x08 | order) << 1, 8);
+            for (unsigned i = 0; i < order; ++i) w.Put(uint32_t(x[i]), bps);
+            w.Put(plan.rice2 ? 1 : 0, 2);
+            w.Put(plan.order, 4);
+            unsigned parts = 1u << plan.order;
+            unsigned psize = n >> plan.order;
+            for (unsigned j = 0, i = order; j < parts; ++j) {
+                unsigned k = plan.k[j];
+                w.Put(k, plan.rice2 ? 5 : 4);
+                for (unsigned end = (j + 1) * psize; i < end; ++i) w.PutRice(u[i], k);
+            }
+            break;
+        }
+        }
+    }
+};
+
+void PutUtf8(BitWriter &w, uint64_t v) {
+    if (v < 0x80) {
+        w.Put(uint32_t(v), 8);
+        return;
+    }
+    unsigned bytes = 2;
+    while (bytes < 7 && v >= (uint64_t(1) << (5 * bytes + 1))) ++bytes;
+    unsigned shift = 6 * (bytes - 1);
+    w.Put(uint32_t((0xFF00u >> bytes) | (v >> shift)), 8);
+    while (shift) {
+        shift -= 6;
+        w.Put(0x80 | ((v >> shift) & 0x3F), 8);
+    }
+}
+
+void PutLe32(std::vector<uint8_t> &out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+}  // namespace
+
+Encoder::Encoder(FILE *f, unsigned channels, unsigned bits, unsigned samplerate,
+                 const Tags &tags)
+    : f_(f), channels_(channels), bits_(bits), samplerate_(samplerate) {
+    start_ = std::ftell(f_);
+    if (channels_ < 1 || channels_ > 8 || (bits_ != 16 && bits_ != 24) ||
+        samplerate_ == 0 || samplerate_ >= (1u << 20)) {
+        ok_ = false;
+        return;
+    }
+    for (unsigned c = 0; c < channels_; ++c) block_[c].resize(kBlockSize);
+    md5_.Init();
+    ok_ = WriteHeader(tags);
+}
+
+bool Encoder::WriteHeader(const Tags &tags) {
+    static const uint8_t kMagic[] = { 'f', 'L', 'a', 'C', 0x00, 0x00, 0x00, 34 };  // then STREAMINFO
+    out_.assign(kMagic, kMagic + sizeof(kMagic));
+
+    BitWriter w(out_);
+    w.Put(kBlockSize, 16);  // min/max block size
+    w.Put(kBlockSize, 16);
+    w.Put(0, 24);  // min/max frame size, unknown
+    w.Put(0, 24);
+    w.Put(samplerate_, 20);
+    w.Put(channels_ - 1, 3);
+    w.Put(bits_ - 1, 5);
+    w.Put(0, 4);   // total samples, unknown
+    w.Put(0, 32);
+    for (int i = 0; i < 4; ++i) w.Put(0, 32);  // MD5, unset
+
+    std::vector<uint8_t> vc;
+    static const char kVendor[] = "nsfplay";
+    PutLe32(vc, sizeof(kVendor) - 1);
+    vc.insert(vc.end(), kVendor, kVendor + sizeof(kVendor) - 1);
+    PutLe32(vc, uint32_t(tags.size()));
+    for (const auto &tag : tags) {
+        std::string s = tag.first + "=" + tag.second;
+        PutLe32(vc, uint32_t(s.size()));
+        vc.insert(vc.end(), s.begin(), s.end());
+    }
+    out_.push_back(0x80 | 4);  // last metadata block, VORBIS_COMMENT
+    out_.push_back(uint8_t(vc.size() >> 16));
+    out_.push_back(uint8_t(vc.size() >> 8));
+    out_.push_back(uint8_t(vc.size()));
+    out_.insert(out_.end(), vc.begin(), vc.end());
+
+    return std::fwrite(out_.data(), 1, out_.size(), f_) == out_.size();
+}
+
+bool Encoder::Write(const int32_t *samples, size_t frames) {
+    if (!ok_) return false;
+    UpdateMd5(samples, frames);
+    total_frames_ += frames;
+    while (frames) {
+        size_t n = std::min<size_t>(frames, kBlockSize - fill_);
+        for (unsigned c = 0; c < channels_; ++c) {
+            int32_t *d = block_[c].data() + fill_;
+            const int32_t *s = samples + c;
+            for (size_t i = 0; i < n; ++i, s += channels_) d[i] = *s;
+        }
+        fill_ += unsigned(n);
+        samples += n * channels_;
+        frames -= n;
+        if (fill_ == kBlockSize) {
+            if (!EncodeFrame(kBlockSize)) return false;
+            fill_ = 0;
+        }
+    }
+    return true;
+}
+
+bool Encoder::EncodeFrame(unsigned n) {
+    Subframe sf[8];
+    const Subframe *coded[8];
+    unsigned assignment = channels_ - 1;
+    std::vector<int32_t> side, mid;
+
+    if (channels_ == 2) {
+        // left, right, side (one extra bit) and mid, keep the cheapest pair
+        const int32_t *l = block_[0].data();
+        const int32_t *r = block_[1].data();
+        side.resize(n);
+        mid.resize(n);
+        for (unsigned i = 0; i < n; ++i) {
+            side[i] = l[i] - r[i];
+            mid[i] = (l[i] + r[i]) >> 1;
+        }
+        Subframe &L = sf[0], &R = sf[1], &S = sf[2], &M = sf[3];
+        L.Analyze(l, n, bits_);
+        R.Analyze(r, n, bits_);
+        S.Analyze(side.data(), n, bits_ + 1);
+        M.Analyze(mid.data(), n, bits_);
+
+        uint64_t best = L.bits + R.bits;
+        coded[0] = &L; coded[1] = &R;
+        if (L.bits + S.bits < best) { best = L.bits + S.bits; assignment = 8; coded[0] = &L; coded[1] = &S; }
+        if (S.bits + R.bits < best) { best = S.bits + R.bits; assignment = 9; coded[0] = &S; coded[1] = &R; }
+        if (M.bits + S.bits < best) { best = M.bits + S.bits; assignment = 10; coded[0] = &M; coded[1] = &S; }
+    } else {
+        for (unsigned c = 0; c < channels_; ++c) {
+            sf[c].Analyze(block_[c].data(), n, bits_);
+            coded[c] = &sf[c];
+        }
+    }
+
+    out_.clear();
+    BitWriter w(out_);
+    w.Put(0xFFF8, 16);  // sync, fixed block size
+    unsigned size_code = (n == kBlockSize) ? 12 : (n <= 256 ? 6 : 7);
+    w.Put(size_code, 4);
+    w.Put(0, 4);        // sample rate from STREAMINFO
+    w.Put(assignment, 4);
+    w.Put(bits_ == 24 ? 6 : 4, 3);
+    w.Put(0, 1);
+    PutUtf8(w, frame_number_);
+    if (size_code == 6) w.Put(n - 1, 8);
+    if (size_code == 7) w.Put(n - 1, 16);
+    w.Put(Crc8(out_.data(), out_.size()), 8);
+
+    for (unsigned c = 0; c < channels_; ++c) coded[c]->Write(w, n);
+    w.Align();
+    w.Put(Crc16(out_.data(), out_.size()), 16);
+
+    ++frame_number_;
+    uint32_t bytes = uint32_t(out_.size());
+    if (bytes < min_frame_bytes_) min_frame_bytes_ = bytes;
+    if (bytes > max_frame_bytes_) max_frame_bytes_ = bytes;
+    ok_ = std::fwrite(out_.data(), 1, out_.size(), f_) == out_.size();
+    return ok_;
+}
+
+void Encoder::UpdateMd5(const int32_t *samples, size_t frames) {
+    // the MD5 is over the little-endian interleaved samples
+    unsigned bytes = bits_ / 8;
+    uint8_t buf[1024 * 3];
+    size_t total = frames * channels_;
+    while (total) {
+        size_t count = std::min<size_t>(total, 1024);
+        uint8_t *d = buf;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t v = uint32_t(samples[i]);
+            for (unsigned b = 0; b < bytes; ++b) *d++ = uint8_t(v >> (8 * b));
+        }
+        md5_.Update(buf, count * bytes);
+        samples += count;
+        total -= count;
+    }
+}
+
+bool Encoder::Finish() {
+    if (!ok_) return false;
+    if (fill_ && !EncodeFrame(fill_)) return false;
+    fill_ = 0;
+    if (std::fflush(f_) != 0) return ok_ = false;
+    if (start_ < 0) return true;  // not seekable, leave the totals unknown
+
+    uint8_t digest[16];
+    md5_.Final(digest);
+    unsigned block = total_frames_ < kBlockSize ? unsigned(total_frames_) : kBlockSize;
+    if (frame_number_ == 0) min_frame_bytes_ = 0;
+
+    std::vector<uint8_t> info;
+    BitWriter w(info);
+    w.Put(block, 16);
+    w.Put(block, 16);
+    w.Put(min_frame_bytes_, 24);
+    w.Put(max_frame_bytes_, 24);
+    w.Put(samplerate_, 20);
+    w.Put(channels_ - 1, 3);
+    w.Put(bits_ - 1, 5);
+    w.Put(uint32_t(total_frames_ >> 32), 4);
+    w.Put(uint32_t(total_frames_), 32);
+    for (int i = 0; i < 16; ++i) w.Put(digest[i], 8);
+
+    if (std::fseek(f_, start_ + 8, SEEK_SET) != 0) return true;
+    ok_ = std::fwrite(info.data(), 1, info.size(), f_) == info.size();
+    ok_ = std::fseek(f_, 0, SEEK_END) == 0 && ok_;
+    return ok_;
+}
+
+// RFC 1321
+namespace {
+
+inline uint32_t Rotl(uint32_t x, int c) { return (x << c) | (x >> (32 - c)); }
+
+const uint32_t kMd5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+const int kMd5R[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+}  // namespace
+
+void Encoder::Md5::Init() {
+    state[0] = 0x67452301;
+    state[1] = 0xefcdab89;
+    state[2] = 0x98badcfe;
+    state[3] = 0x10325476;
+    length = 0;
+}
+
+void Encoder::Md5::Transform(const uint8_t in[64]) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = uint32_t(in[i*4]) | (uint32_t(in[i*4+1]) << 8) |
+               (uint32_t(in[i*4+2]) << 16) | (uint32_t(in[i*4+3]) << 24);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t f;
+        int g;
+        if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+        else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) & 15; }
+        else             { f = c ^ (b | ~d);       g = (7 * i) & 15; }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        b = b + Rotl(a + f + kMd5K[i] + m[g], kMd5R[i]);
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void Encoder::Md5::Update(const uint8_t *data, size_t size) {
+    size_t used = size_t(length & 63);
+    length += size;
+    if (used) {
+        size_t n = std::min<size_t>(size, 64 - used);
+        std::memcpy(block + used, data, n);
+        data += n;
+        size -= n;
+        if (used + n < 64) return;
+        Transform(block);
+    }
+    for (; size >= 64; data += 64, size -= 64) Transform(data);
+    std::memcpy(block, data, size);
+}
+
+void Encoder::Md5::Final(uint8_t digest[16]) {
+    uint64_t bits = length * 8;
+    static const uint8_t kPad[64] = { 0x80 };
+    size_t used = size_t(length & 63);
+    Update(kPad, used < 56 ? 56 - used : 120 - used);
+    uint8_t len[8];
+    for (int i = 0; i < 8; ++i) len[i] = uint8_t(bits >> (8 * i));
+    Update(len, 8);
+    for (int i = 0; i < 16; ++i) digest[i] = uint8_t(state[i / 4] >> (8 * (i % 4)));
+}
+
+}  // namespace flacenc
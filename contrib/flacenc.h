@@ -0,0 +1,72 @@
+/* a small, dependency-free FLAC encoder for 16 and 24-bit PCM
+ *
+ * Each block is coded with the cheapest of constant, verbatim and the fixed
+ * polynomial predictors of order 0 to 4, with partitioned Rice residuals and
+ * the best of the four stereo decorrelation modes. There is no LPC, which
+ * keeps the encoder small and fast.
+ */
+
+#ifndef FLACENC_H
+#define FLACENC_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace flacenc {
+
+// Vorbis comments, e.g. { "TITLE", "..." }; values must be UTF-8.
+using Tags = std::vector<std::pair<std::string, std::string>>;
+
+class Encoder {
+public:
+    static constexpr unsigned kBlockSize = 4096;
+
+    // Writes the stream header to f at once. bits is 16 or 24, channels 1
+    // to 8. The STREAMINFO totals and MD5 are patched in by Finish when f
+    // is seekable and left as unknown otherwise.
+    Encoder(FILE *f, unsigned channels, unsigned bits, unsigned samplerate,
+            const Tags &tags);
+
+    // Adds frames of interleaved samples, returns false on a write error.
+    bool Write(const int32_t *samples, size_t frames);
+
+    // Codes the last partial block and completes the header.
+    bool Finish();
+
+    uint64_t TotalFrames() const { return total_frames_; }
+
+private:
+    struct Md5 {
+        uint32_t state[4];
+        uint64_t length;
+        uint8_t block[64];
+        void Init();
+        void Update(const uint8_t *data, size_t size);
+        void Final(uint8_t digest[16]);
+        void Transform(const uint8_t block[64]);
+    };
+
+    bool WriteHeader(const Tags &tags);
+    bool EncodeFrame(unsigned n);
+    void UpdateMd5(const int32_t *samples, size_t frames);
+
+    FILE *f_;
+    long start_;        // offset of "fLaC", -1 if f is not seekable
+    unsigned channels_, bits_, samplerate_;
+    bool ok_ = true;
+
+    std::vector<int32_t> block_[8];  // de-interleaved input, per channel
+    unsigned fill_ = 0;
+    uint64_t frame_number_ = 0;
+    uint64_t total_frames_ = 0;
+    uint32_t min_frame_bytes_ = 0xFFFFFF, max_frame_bytes_ = 0;
+    Md5 md5_;
+    std::vector<uint8_t> out_;
+};
+
+}  // namespace flacenc
+
+#endif
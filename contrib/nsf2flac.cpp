@@ -0,0 +1,434 @@
+/* converts NSF/NSFe tracks to FLAC in a single process
+ * 1. tags are taken from the NSF/NSFe metadata
+ * 2. rendering and FLAC encoding run on separate threads
+ * 3. any number of tracks per run, optionally several at once
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../xgm/xgm.h"
+#include "flacenc.h"
+#include "toutf8.h"
+
+namespace {
+
+const char *progname;
+
+constexpr const uint64_t kFramesToBuffer = 4096;
+constexpr const size_t kBlocksQueued = 8;
+
+struct Nsf2FlacOptions {
+    Nsf2FlacOptions(const xgm::NSF &nsf)
+        : length_ms(nsf.default_playtime),
+          fade_ms(nsf.default_fadetime)
+    {}
+
+    int32_t length_ms;
+    int32_t fade_ms;
+    int channels = 1;
+    int bits = 16;
+    double samplerate = xgm::DEFAULT_RATE;
+    std::vector<int> tracks;  // 1-based, empty for all
+    bool all_tracks = false;
+    std::string output;
+    std::string encoding;
+    int jobs = 1;
+    bool quiet = false;
+    bool lengthForce = false;
+    flacenc::Tags tags;
+};
+
+void Usage(FILE *output, int exit_code, const xgm::NSF &nsf) {
+    Nsf2FlacOptions defaults(nsf);
+    fprintf(
+        output,
+        R"(Usage: %s [options] (/path/to/nsf[e] | nez m3u entry) [out.flac]
+Convert NSF[e] tracks to FLAC, tagged with the NSF[e] metadata.
+
+The output name may contain %%n, which is replaced by the two-digit track
+number; it must when more than one track is converted. The default is the
+NSF name with -%%n.flac in place of its extension.
+
+Options:
+ -t, --track=1           Track number, starting with 1. May be repeated or be
+                         a comma separated list; "all" converts every track.
+ -j, --jobs=%-12d Convert this many tracks at a time.
+ -c, --channels=%-8d The number of audio channels to output.
+ -b, --bits=%-12d Bits per sample, 16 or 24.
+ -s, --samplerate=%-6.0f The audio sample rate.
+ -l, --length_ms=%-7d The length in milliseconds to output, if the NSF does
+                         not give one.
+ -f, --fade_ms=%-9d The length of time in milliseconds to fade out at the
+                         end of the song, if the NSF does not give one.
+ -y, --length_force      Output the full length even if the track loops or
+                         ends earlier.
+ -e, --encoding=         The encoding of the NSF metadata, converted to UTF-8
+                         for the tags. Default: the locale's.
+ -T, --tag=NAME=VALUE    Add a tag, may be repeated.
+ -q, --quiet             Suppress all non-error output.
+ -h, --help              Show this help message.
+)",
+        progname, defaults.jobs, defaults.channels, defaults.bits,
+        defaults.samplerate, defaults.length_ms, defaults.fade_ms);
+    exit(exit_code);
+}
+
+void ParseTracks(const char *arg, Nsf2FlacOptions *options, const xgm::NSF &nsf) {
+    if (strcmp(arg, "all") == 0) {
+        options->all_tracks = true;
+        return;
+    }
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == std::string::npos) end = s.size();
+        char *stop = nullptr;
+        long track = strtol(s.c_str() + pos, &stop, 10);
+        if (stop != s.c_str() + end || track <= 0) {
+            fprintf(stderr, "error: bad track number in '%s', tracks start with 1\n", arg);
+            Usage(stderr, EX_USAGE, nsf);
+        }
+        options->tracks.push_back(int(track));
+        pos = end + 1;
+    }
+}
+
+Nsf2FlacOptions ParseOptions(int *argc, char ***argv, const xgm::NSF &nsf) {
+    static constexpr struct option longopts[] = {
+        { "help", no_argument, nullptr, 'h' },
+        { "track", required_argument, nullptr, 't' },
+        { "jobs", required_argument, nullptr, 'j' },
+        { "channels", required_argument, nullptr, 'c' },
+        { "bits", required_argument, nullptr, 'b' },
+        { "samplerate", required_argument, nullptr, 's' },
+        { "length_ms", required_argument, nullptr, 'l' },
+        { "fade_ms", required_argument, nullptr, 'f' },
+        { "length_force", no_argument, nullptr, 'y' },
+        { "encoding", required_argument, nullptr, 'e' },
+        { "tag", required_argument, nullptr, 'T' },
+        { "quiet", no_argument, nullptr, 'q' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    Nsf2FlacOptions options(nsf);
+    int ch = 0;
+    while ((ch = getopt_long(*argc, *argv, "ht:j:c:b:s:l:f:ye:T:q", longopts, NULL)) != -1) {
+        switch (ch) {
+        case 't':
+            ParseTracks(optarg, &options, nsf);
+            break;
+        case 'j':
+            options.jobs = std::max(1, std::stoi(optarg));
+            break;
+        case 'c':
+            options.channels = std::stoi(optarg);
+            if (options.channels != 1 && options.channels != 2) Usage(stderr, EX_USAGE, nsf);
+            break;
+        case 'b':
+            options.bits = std::stoi(optarg);
+            if (options.bits != 16 && options.bits != 24) Usage(stderr, EX_USAGE, nsf);
+            break;
+        case 's':
+            options.samplerate = std::stod(optarg);
+            break;
+        case 'l':
+            options.length_ms = std::stoi(optarg);
+            break;
+        case 'f':
+            options.fade_ms = std::stoi(optarg);
+            break;
+        case 'y':
+            options.lengthForce = true;
+            break;
+        case 'e':
+            options.encoding = optarg;
+            break;
+        case 'T': {
+            const char *eq = strchr(optarg, '=');
+            if (eq == nullptr || eq == optarg) Usage(stderr, EX_USAGE, nsf);
+            options.tags.emplace_back(std::string(optarg, eq - optarg), eq + 1);
+            break;
+        }
+        case 'q':
+            options.quiet = true;
+            break;
+        case 'h':
+            Usage(stdout, EXIT_SUCCESS, nsf);
+        default:
+            Usage(stderr, EX_USAGE, nsf);
+        }
+    }
+    *argc -= optind;
+    *argv += optind;
+    return options;
+}
+
+// blocks of interleaved samples from the render thread to the encoder thread
+class BlockQueue {
+public:
+    void Push(std::vector<int32_t> block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [this] { return blocks_.size() < kBlocksQueued; });
+        blocks_.push_back(std::move(block));
+        ready_.notify_one();
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        ready_.notify_one();
+    }
+
+    // false once closed and drained
+    bool Pop(std::vector<int32_t> *block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return !blocks_.empty() || closed_; });
+        if (blocks_.empty()) return false;
+        *block = std::move(blocks_.front());
+        blocks_.pop_front();
+        space_.notify_one();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_, space_;
+    std::deque<std::vector<int32_t>> blocks_;
+    bool closed_ = false;
+};
+
+std::mutex output_mutex;  // keeps progress lines whole between jobs
+
+std::string OutputPath(const std::string &pattern, int track) {
+    char num[16];
+    snprintf(num, sizeof(num), "%02d", track);
+    std::string path = pattern;
+    for (size_t pos; (pos = path.find("%n")) != std::string::npos;) path.replace(pos, 2, num);
+    return path;
+}
+
+std::string DefaultPattern(const char *nsf_path) {
+    std::string path(nsf_path);
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) path.erase(dot);
+    slash = path.find_last_of('/');
+    if (slash != std::string::npos) path.erase(0, slash + 1);
+    return path + "-%n.flac";
+}
+
+// Renders track i (0-based) of the file to a FLAC file.
+bool ConvertTrack(const char *nsf_path, int i, const std::string &out_path,
+                  Nsf2FlacOptions options) {
+    xgm::NSF nsf;
+    xgm::NSFPlayerConfig config;
+    xgm::NSFPlayer player;
+    nsf.SetDefaults(options.length_ms, options.fade_ms, nsf.default_loopnum);
+    if (!nsf.LoadFile(nsf_path)) {
+        fprintf(stderr, "Error loading NSF: %s\n", nsf.LoadError());
+        return false;
+    }
+    if (nsf.playlist_mode) i = nsf.song;
+
+    int nsfe_i = i;
+    if (!nsf.playlist_mode && nsf.nsfe_plst) nsfe_i = nsf.nsfe_plst[i];
+    const xgm::NSFE_Entry &entry = nsf.nsfe_entry[nsfe_i];
+
+    if (!nsf.playlist_mode && entry.time >= 0) {
+        options.length_ms = entry.time;
+    } else if (nsf.time_in_ms >= 0) {
+        options.length_ms = nsf.time_in_ms;
+    }
+    if (!nsf.playlist_mode && entry.fade >= 0) {
+        options.fade_ms = entry.fade;
+    } else if (nsf.fade_in_ms >= 0) {
+        options.fade_ms = nsf.fade_in_ms;
+    }
+
+    // tags as the old nsf2flac script set them, plus the NSFe track labels
+    nsfplay::ToUTF8 utf8(options.encoding);
+    flacenc::Tags tags;
+    auto tag = [&](const char *name, const char *value, size_t len) {
+        if (value != nullptr && len > 0) {
+            tags.emplace_back(name, utf8.Convert(std::string_view(value, len)));
+        }
+    };
+    auto tag_str = [&](const char *name, const char *value) {
+        tag(name, value, value ? strlen(value) : 0);
+    };
+    bool has_tlbl = !nsf.playlist_mode && entry.tlbl && entry.tlbl[0];
+    if (has_tlbl) {
+        tag_str("TITLE", entry.tlbl);
+        tag_str("ALBUM", nsf.title);
+    } else {
+        tag_str("TITLE", nsf.title);
+    }
+    tag_str("ARTIST", (!nsf.playlist_mode && entry.taut && entry.taut[0]) ? entry.taut : nsf.artist);
+    tag_str("COPYRIGHT", nsf.copyright);
+    tag_str("ORGANIZATION", nsf.ripper);
+    tag("DESCRIPTION", nsf.text, nsf.text ? nsf.text_len : 0);
+    tags.emplace_back("TRACKNUMBER", std::to_string(i + 1));
+    tags.insert(tags.end(), options.tags.begin(), options.tags.end());
+
+    config["MASTER_VOLUME"] = 256; /* default volume = 128 */
+    config["APU2_OPTION5"] = 0; /* disable randomized noise phase at reset */
+    config["APU2_OPTION7"] = 0; /* disable randomized tri phase at reset */
+    if (!options.lengthForce) {
+        config["AUTO_DETECT"] = 1;
+        config["LOOP_NUM"] = 2;
+        nsf.loop_num = 2;
+        config["DETECT_INT"] = 1000;
+    }
+
+    player.SetConfig(&config);
+    if (!player.Load(&nsf)) {
+        fprintf(stderr, "Error with player load\n");
+        return false;
+    }
+    player.SetPlayFreq(options.samplerate);
+    player.SetChannels(options.channels);
+    player.SetSong(i);
+    player.Reset();
+
+    constexpr uint64_t kMillisPerSecond = 1000;
+    uint64_t frames = ((uint64_t)options.length_ms + options.fade_ms) *
+                      (uint64_t)options.samplerate / kMillisPerSecond;
+
+    // find the loop point first, as nsf2wav does
+    if (!options.lengthForce) {
+        uint64_t left = frames;
+        while (left && !player.fader.IsFading()) {
+            uint64_t fc = std::min(left, kFramesToBuffer);
+            player.Skip(fc);
+            left -= fc;
+        }
+        if (player.playtime_detected) {
+            config["AUTO_DETECT"] = 0;
+            config["LOOP_NUM"] = 0;
+            frames = player.total_render +
+                     ((uint64_t)nsf.GetFadeTime() * options.samplerate / kMillisPerSecond);
+        }
+        config["STOP_SEC"] = std::ceil((player.total_render +
+            ((uint64_t)nsf.GetFadeTime() / kMillisPerSecond)) / options.samplerate);
+        config.Notify(-1);
+        player.SetConfig(&config);
+        player.Reset();
+    }
+
+    FILE *f = fopen(out_path.c_str(), "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Error opening %s: %s\n", out_path.c_str(), strerror(errno));
+        return false;
+    }
+    if (!options.quiet) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        printf("Track %03d: %s -> %s\n", i + 1,
+               has_tlbl ? entry.tlbl : nsf.title, out_path.c_str());
+        printf("  length: %" PRIu64 " ms\n", frames * kMillisPerSecond / (uint64_t)options.samplerate);
+    }
+
+    flacenc::Encoder encoder(f, options.channels, options.bits,
+                             (unsigned)options.samplerate, tags);
+    BlockQueue queue;
+    bool encoded = true;
+    std::thread encode_thread([&] {
+        std::vector<int32_t> block;
+        while (queue.Pop(&block)) {
+            encoded = encoder.Write(block.data(), block.size() / options.channels) && encoded;
+        }
+    });
+
+    std::vector<int16_t> buf16(kFramesToBuffer * options.channels);
+    while (frames) {
+        uint64_t fc = std::min(frames, kFramesToBuffer);
+        std::vector<int32_t> block(fc * options.channels);
+        if (options.bits == 24) {
+            player.Render24(block.data(), fc);
+        } else {
+            player.Render(buf16.data(), fc);
+            std::copy(buf16.begin(), buf16.begin() + block.size(), block.begin());
+        }
+        queue.Push(std::move(block));
+        frames -= fc;
+    }
+    queue.Close();
+    encode_thread.join();
+
+    encoded = encoder.Finish() && encoded;
+    encoded = (fclose(f) == 0) && encoded;
+    if (!encoded) fprintf(stderr, "Error writing %s: %s\n", out_path.c_str(), strerror(errno));
+    return encoded;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    progname = argv[0];
+
+    xgm::NSF nsf;
+    Nsf2FlacOptions options = ParseOptions(&argc, &argv, nsf);
+    if (argc < 1 || argc > 2) Usage(stderr, EX_USAGE, nsf);
+
+    nsf.SetDefaults(options.length_ms, options.fade_ms, nsf.default_loopnum);
+    if (!nsf.LoadFile(argv[0])) {
+        fprintf(stderr, "Error loading NSF: %s\n", nsf.LoadError());
+        return EXIT_FAILURE;
+    }
+
+    int songs = nsf.nsfe_plst_size > 0 ? nsf.nsfe_plst_size : nsf.total_songs;
+    std::vector<int> tracks;
+    if (nsf.playlist_mode) {
+        tracks.push_back(nsf.song + 1);
+    } else if (options.all_tracks) {
+        for (int t = 1; t <= songs; ++t) tracks.push_back(t);
+    } else {
+        tracks = options.tracks;
+        if (tracks.empty()) tracks.push_back(1);
+    }
+    for (int t : tracks) {
+        if (t > songs && !nsf.playlist_mode) {
+            fprintf(stderr, "error: track %d out of range, %s has %d\n", t, argv[0], songs);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::string pattern = argc == 2 ? argv[1] : DefaultPattern(argv[0]);
+    if (tracks.size() > 1 && pattern.find("%n") == std::string::npos) {
+        fprintf(stderr, "error: the output name needs %%n to convert more than one track\n");
+        return EX_USAGE;
+    }
+
+    // each job takes the next track until none are left
+    std::atomic<size_t> next(0);
+    std::atomic<bool> ok(true);
+    auto job = [&] {
+        for (size_t k; (k = next++) < tracks.size();) {
+            int t = tracks[k];
+            if (!ConvertTrack(argv[0], t - 1, OutputPath(pattern, t), options)) ok = false;
+        }
+    };
+    std::vector<std::thread> jobs;
+    size_t njobs = std::min<size_t>(options.jobs, tracks.size());
+    for (size_t j = 1; j < njobs; ++j) jobs.emplace_back(job);
+    job();
+    for (std::thread &t : jobs) t.join();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,6 +2,8 @@
  * 1. loading an NSF/NSFe or playlist line
  * 2. probing track/time info
  * 3. converting to WAV
+ * 4. measuring the loudness of the output
+ * 5. making a waveform overview, with or without the WAV
  */
 
 #include <errno.h>
@@ -12,26 +14,32 @@
 #include <stdlib.h>
 #include <sysexits.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
+#include <string>
 
 #include "../xgm/xgm.h"
+#include "nlohmann/json.hpp"
+#include "pcmsink.h"
 
 namespace {
 
-struct Nsf2WavOptions;
-void pack_int16le(uint8_t *d, int16_t n);
-void pack_uint16le(uint8_t *d, uint16_t n);
-void pack_uint32le(uint8_t *d, uint32_t n);
-void pack_frames(uint8_t *d, int16_t *s, unsigned int frameCount, int channels);
-int write_wav_header(FILE *f, uint64_t totalFrames, const Nsf2WavOptions &options);
-int write_frames(FILE *f, uint8_t *d, unsigned int frameCount, int channels);
-
 const char *progname;
 
 constexpr const uint64_t kFramesToBuffer = 4096;
 
+using pcmsink::SampleFormat;
+using json = nlohmann::json;
+
+/* ReplayGain 2.0 reference level */
+constexpr double kReplayGainLufs = -18.0;
+
+/* sample rate for --overview without an output file */
+constexpr double kOverviewRate = 11025.0;
+
 struct Nsf2WavOptions {
     Nsf2WavOptions(const xgm::NSF &nsf)
         : length_ms(nsf.default_playtime),
@@ -41,6 +49,8 @@ struct Nsf2WavOptions {
     int32_t length_ms;
     int32_t fade_ms;
     int channels = 1;
+    SampleFormat format = SampleFormat::kS16;
+    pcmsink::Container container = pcmsink::Container::kAuto;
     double samplerate = xgm::DEFAULT_RATE;
     int track = 1;
     bool quiet = false;
@@ -48,6 +58,12 @@ struct Nsf2WavOptions {
 	uint64_t mute = 0;
     bool trigger = false;
 	bool lengthForce = false;
+    bool profile = false;
+    bool hotspots = false;
+    std::string flamegraph;
+    std::string loudness;
+    std::string overview;
+    int bucket_ms = 10;
 };
 
 void Usage(FILE *output, int exit_code, const xgm::NSF &nsf) {
@@ -62,12 +78,19 @@ Nez M3U playlist entry. See http://www.vgmpf.com/Wiki/index.php/NEZ_Plug for
 the Nez M3U format.
 
 If no output file is specified, nsf2wav will print information about the NSF
-to the screen and then exit without performing any conversion.
+to the screen and then exit without performing any conversion. An output file
+of - writes to stdout.
 
 Options:
  -c, --channels=%-8d The number of audio channels to output.
  -f, --fade_ms=%-9d The length of time in milliseconds to fade out at the
                          end of the song.
+ -b, --format=s16        Sample format: s16, s24 or f32. s24 and f32 keep full
+                         precision through the output filters; f32 is not
+                         clipped (1.0 = 16-bit full scale).
+ -k, --container=auto    Output file type: wav, rf64, w64, raw or auto, which
+                         goes by the file extension (.rf64, .w64, .raw or
+                         .pcm, otherwise wav). wav switches to RF64 past 4GB.
  -h, --help              Show this help message.
  -l, --length_ms=%-7d The length in milliseconds to output. The final file
                          may be shorter than specified if the NSF program
@@ -82,9 +105,25 @@ Options:
  -r, --mask_reverse	 Invert channel masking options to be soloing channels instead.
  -u, --mute		 Use the masking settings set so far as muting, reset masking options.
  -w, --trigger		 Output trigger waves instead of normal output.
+ -p, --profile           Print render time per emulation stage to stderr.
+                         Requires a build with NSFPLAY_PROFILE=1.
+ -H, --hotspots          Print the 6502 routines and PCs using the most cycles
+                         to stderr. Requires a build with NSFPLAY_PROFILE=1.
+ -g, --flamegraph=<file> Write 6502 cycles per JSR call stack to a file, in
+                         the collapsed format read by flamegraph.pl.
+                         Requires a build with NSFPLAY_PROFILE=1.
+ -L, --loudness=<file>   Measure the EBU R128 integrated loudness and true peak
+                         while rendering and write them, with the matching
+                         ReplayGain values, as JSON to a file (- for stdout).
+ -O, --overview=<file>   Write a waveform overview as JSON to a file (- for
+                         stdout): min, max and RMS of every bucket, as 16-bit
+                         values. Without an output file only the overview is
+                         made, from a fast %.0fHz render with QUALITY=1 and
+                         no lowpass filter.
+ -B, --bucket_ms=%-7d Overview bucket length in milliseconds.
 )",
         progname, defaults.channels, defaults.fade_ms, defaults.length_ms,
-        defaults.samplerate, defaults.track);
+        defaults.samplerate, defaults.track, kOverviewRate, defaults.bucket_ms);
     exit(exit_code);
 }
 
@@ -97,16 +136,24 @@ Nsf2WavOptions ParseOptions(int *argc, char ***argv, const xgm::NSF &nsf) {
         { "track", required_argument, nullptr, 't' },
         { "samplerate", required_argument, nullptr, 's' },
         { "channels", required_argument, nullptr, 'c' },
+        { "format", required_argument, nullptr, 'b' },
+        { "container", required_argument, nullptr, 'k' },
         { "quiet", no_argument, nullptr, 'q' },
         { "mask", required_argument, nullptr, 'm' },
         { "mask_reverse", no_argument, nullptr, 'r' },
 		{ "mute", no_argument, nullptr, 'u' },
         { "trigger", no_argument, nullptr, 'w' },
+        { "profile", no_argument, nullptr, 'p' },
+        { "hotspots", no_argument, nullptr, 'H' },
+        { "flamegraph", required_argument, nullptr, 'g' },
+        { "loudness", required_argument, nullptr, 'L' },
+        { "overview", required_argument, nullptr, 'O' },
+        { "bucket_ms", required_argument, nullptr, 'B' },
         { nullptr, 0, nullptr, 0 }
     };
     Nsf2WavOptions options(nsf);
     int ch = 0;
-    while ((ch = getopt_long(*argc, *argv, "hl:s:f:c:", longopts, NULL)) != -1) {
+    while ((ch = getopt_long(*argc, *argv, "hl:s:f:c:b:k:qt:ym:ruwpHg:L:O:B:", longopts, NULL)) != -1) {
         switch (ch) {
         case 'q':
             options.quiet = true;
@@ -129,6 +176,20 @@ Nsf2WavOptions ParseOptions(int *argc, char ***argv, const xgm::NSF &nsf) {
         case 'c':
             options.channels = std::stoi(optarg);
             break;
+        case 'b':
+            if (strcmp(optarg, "s16") == 0) options.format = SampleFormat::kS16;
+            else if (strcmp(optarg, "s24") == 0) options.format = SampleFormat::kS24;
+            else if (strcmp(optarg, "f32") == 0) options.format = SampleFormat::kF32;
+            else Usage(stderr, EX_USAGE, nsf);
+            break;
+        case 'k':
+            if (strcmp(optarg, "auto") == 0) options.container = pcmsink::Container::kAuto;
+            else if (strcmp(optarg, "wav") == 0) options.container = pcmsink::Container::kWav;
+            else if (strcmp(optarg, "rf64") == 0) options.container = pcmsink::Container::kRF64;
+            else if (strcmp(optarg, "w64") == 0) options.container = pcmsink::Container::kW64;
+            else if (strcmp(optarg, "raw") == 0) options.container = pcmsink::Container::kRaw;
+            else Usage(stderr, EX_USAGE, nsf);
+            break;
         case 'm':
             options.mask |= 1<<std::stoi(optarg);
             break;
@@ -137,6 +198,25 @@ Nsf2WavOptions ParseOptions(int *argc, char ***argv, const xgm::NSF &nsf) {
             break;
         case 'w':
             options.trigger = true;
+            break;
+        case 'p':
+            options.profile = true;
+            break;
+        case 'H':
+            options.hotspots = true;
+            break;
+        case 'g':
+            options.flamegraph = optarg;
+            break;
+        case 'L':
+            options.loudness = optarg;
+            break;
+        case 'O':
+            options.overview = optarg;
+            break;
+        case 'B':
+            options.bucket_ms = std::stoi(optarg);
+            if (options.bucket_ms <= 0) Usage(stderr, EX_USAGE, nsf);
             break;
 		case 'u':
             options.mute = options.mask;
@@ -153,76 +233,34 @@ Nsf2WavOptions ParseOptions(int *argc, char ***argv, const xgm::NSF &nsf) {
     return options;
 }
 
-void pack_int16le(uint8_t *d, int16_t n) {
-    d[0] = (uint8_t)(n      );
-    d[1] = (uint8_t)(n >> 8 );
-}
-
-void pack_uint16le(uint8_t *d, uint16_t n) {
-    d[0] = (uint8_t)(n      );
-    d[1] = (uint8_t)(n >> 8 );
-}
-
-void pack_uint32le(uint8_t *d, uint32_t n) {
-    d[0] = (uint8_t)(n      );
-    d[1] = (uint8_t)(n >> 8 );
-    d[2] = (uint8_t)(n >> 16);
-    d[3] = (uint8_t)(n >> 24);
-}
-
-int write_wav_header(FILE *f, uint64_t totalFrames, const Nsf2WavOptions &options) {
-    unsigned int dataSize = totalFrames * sizeof(int16_t) * options.channels;
-    uint8_t tmp[4];
-    if(fwrite("RIFF",1,4,f) != 4) return 0;
-    pack_uint32le(tmp,dataSize + 44 - 8);
-    if(fwrite(tmp,1,4,f) != 4) return 0;
-
-    if(fwrite("WAVE",1,4,f) != 4) return 0;
-    if(fwrite("fmt ",1,4,f) != 4) return 0;
-
-    pack_uint32le(tmp,16); /*fmtSize */
-    if(fwrite(tmp,1,4,f) != 4) return 0;
-
-    pack_uint16le(tmp,1); /* audioFormat */
-    if(fwrite(tmp,1,2,f) != 2) return 0;
-
-    pack_uint16le(tmp,options.channels); /* numChannels */
-    if(fwrite(tmp,1,2,f) != 2) return 0;
-
-    pack_uint32le(tmp,options.samplerate);
-    if(fwrite(tmp,1,4,f) != 4) return 0;
-
-    pack_uint32le(tmp,options.samplerate * options.channels * sizeof(int16_t));
-    if(fwrite(tmp,1,4,f) != 4) return 0;
-
-    pack_uint16le(tmp,options.channels * sizeof(int16_t));
-    if(fwrite(tmp,1,2,f) != 2) return 0;
-
-    pack_uint16le(tmp,sizeof(int16_t) * 8);
-    if(fwrite(tmp,1,2,f) != 2) return 0;
-
-    if(fwrite("data",1,4,f) != 4) return 0;
-
-    pack_uint32le(tmp,dataSize);
-    if(fwrite(tmp,1,4,f) != 4) return 0;
-
-    return 1;
+bool WriteJson(const std::string &path, const json &j) {
+    FILE *f = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (f == NULL) {
+        fprintf(stderr, "Error opening %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(f, "%s\n", j.dump(4).c_str());
+    if (f != stdout) fclose(f);
+    return true;
 }
 
-void pack_frames(uint8_t *d, int16_t *s, unsigned int frameCount, int channels) {
-    unsigned int i = 0;
-    while(i<frameCount) {
-        pack_int16le(&d[0],s[(i*channels)+0]);
-        if (channels == 2) {
-            pack_int16le(&d[sizeof(int16_t)],s[(i*channels)+1]);
+json OverviewJson(const xgm::WaveformOverview &overview, int track, double samplerate) {
+    json data = json::array();
+    for (const xgm::WaveformOverview::Bucket &b : overview.GetBuckets()) {
+        for (float v : { b.min, b.max, b.rms }) {
+            double s = std::round(v * 32767.0);
+            data.push_back((int)std::max(-32768.0, std::min(32767.0, s)));
         }
-        i++;
-        d += (sizeof(int16_t) * channels);
     }
-}
-
-int write_frames(FILE *f, uint8_t *d, unsigned int frameCount, int channels) {
-    return fwrite(d,sizeof(int16_t) * channels,frameCount,f) == frameCount;
+    json j = json::object();
+    j["track"] = track;
+    j["sample_rate"] = samplerate;
+    j["bucket_ms"] = overview.GetBucketMs();
+    j["channels"] = overview.GetChannels();
+    j["buckets"] = overview.GetBuckets().size() / overview.GetChannels();
+    /* min, max, rms per bucket, channels interleaved */
+    j["data"] = std::move(data);
+    return j;
 }
 
 }  // namespace
@@ -232,7 +270,6 @@ int main(int argc, char *argv[]) {
     int m; /* max track counter */
     uint8_t nsfe_i; /* nsfe playlist track number */
     int fc; /* current # of frames to decode */
-    FILE *f;
     uint64_t frames; /* total pcm frames */
 
     progname = argv[0];
@@ -246,17 +283,26 @@ int main(int argc, char *argv[]) {
 
     if(argc < 1 || argc > 2) Usage(stderr, EX_USAGE, nsf);
 
-    // audio samples, native machine format
-    std::unique_ptr<int16_t[]> buf(new int16_t[kFramesToBuffer * options.channels]);
-    // audio samples, little-endian format
-    std::unique_ptr<uint8_t[]> pac(new uint8_t[kFramesToBuffer * options.channels * (sizeof(uint16_t) / sizeof(uint8_t))]);
-
     if(!nsf.LoadFile(argv[0])) {
         fprintf(stderr,"Error loading NSF: %s\n",nsf.LoadError());
         return 1;
     }
 
-    if(argc == 1) {
+    /* open the output first, so writing to stdout can move messages to stderr */
+    std::unique_ptr<pcmsink::Sink> sink;
+    if(argc == 2) {
+        sink = pcmsink::Open(argv[1], options.container);
+        if(!sink) {
+            fprintf(stderr, "Error opening %s: %s\n", argv[1], strerror(errno));
+            return 1;
+        }
+    }
+
+    /* no output file but an overview wanted: render just for that, cheaply */
+    bool overview_only = argc == 1 && !options.overview.empty();
+    if (overview_only) options.samplerate = kOverviewRate;
+
+    if(argc == 1 && !overview_only) {
         /* dump info */
         /* use playlist order, if available */
 
@@ -340,6 +386,19 @@ int main(int argc, char *argv[]) {
         printf("    fade: %" PRId32 " ms\n", options.fade_ms);
     }
 
+    bool profile_cpu = options.hotspots || !options.flamegraph.empty();
+    if ((options.profile || profile_cpu) && !xgm::Profiler::Enabled()) {
+        fprintf(stderr, "Warning: profiling not compiled in, rebuild with NSFPLAY_PROFILE=1.\n");
+    }
+    config["PROFILE_CPU"] = profile_cpu ? 1 : 0;
+    config["LOUDNESS"] = options.loudness.empty() ? 0 : 1;
+    config["OVERVIEW_MS"] = options.overview.empty() ? 0 : options.bucket_ms;
+    if (overview_only) {
+        config["QUALITY"] = 1;
+        config["LPF"] = 0;
+        config["OUTPUT_FILTER"] = 0;
+    }
+
     config["MASTER_VOLUME"] = 256; /* default volume = 128 */
     config["APU2_OPTION5"] = 0; /* disable randomized noise phase at reset */
     config["APU2_OPTION7"] = 0; /* disable randomized tri phase at reset */
@@ -385,7 +444,7 @@ int main(int argc, char *argv[]) {
 	  		config["AUTO_DETECT"] = 0;
 	  config["LOOP_NUM"] = 0;
 		    frames = player.total_render + ((uint64_t)nsf.GetFadeTime()*options.samplerate/kMillisPerSecond);
-		    printf("Detected loop time successfully, it's %lu\n", frames);
+		    if (!options.quiet) printf("Detected loop time successfully, it's %" PRIu64 " frames\n", frames);
 		    if (options.trigger){
 		        nsf.time_in_ms += nsf.GetFadeTime();
 		        nsf.fade_in_ms = 0;
@@ -414,26 +473,88 @@ int main(int argc, char *argv[]) {
 	}
 	config.Notify(-1);
     player.SetConfig(&config);
+    player.GetProfile().Clear(); // only profile the final pass, including INIT
+    player.GetCPUProfile().Clear();
     player.Reset();
 
-    f = fopen(argv[1],"wb");
-    if(f == NULL) {
-        fprintf(stderr, "Error opening %s: %s\n", argv[1], strerror(errno));
-        return 1;
+    if (sink) {
+        pcmsink::Format format;
+        format.channels = options.channels;
+        format.samplerate = (unsigned)options.samplerate;
+        format.sample = options.format;
+
+        /* render into one buffer while the other is written */
+        bool ok = sink->Begin(format, frames);
+        {
+            pcmsink::DoubleBufferedWriter writer(sink.get(), format, kFramesToBuffer);
+            while(ok && frames) {
+                fc = std::min(frames, kFramesToBuffer);
+                switch (options.format) {
+                case SampleFormat::kS24:
+                    player.Render24(static_cast<int32_t *>(writer.Buffer()), fc);
+                    break;
+                case SampleFormat::kF32:
+                    player.RenderFloat(static_cast<float *>(writer.Buffer()), fc);
+                    break;
+                default:
+                    player.Render(static_cast<int16_t *>(writer.Buffer()), fc);
+                    break;
+                }
+                ok = writer.Commit(fc);
+                frames -= fc;
+            }
+            ok = writer.Finish() && ok;
+        }
+        ok = sink->End() && ok;
+        if (!ok) {
+            fprintf(stderr, "Error writing %s: %s\n", argv[1], strerror(errno));
+            return 1;
+        }
+    } else {
+        /* overview only, the audio itself is dropped */
+        std::unique_ptr<int16_t[]> scratch(new int16_t[kFramesToBuffer * options.channels]);
+        while(frames) {
+            fc = std::min(frames, kFramesToBuffer);
+            player.Render(scratch.get(), fc);
+            frames -= fc;
+        }
     }
 
-    write_wav_header(f, frames, options);
-
-    while(frames) {
-        fc = std::min(frames, kFramesToBuffer);
-		printf("%lu, %lu\n", frames+player.total_render, frames);
-        player.Render(buf.get(), fc);
-        pack_frames(pac.get(), buf.get(), fc, options.channels);
-        write_frames(f, pac.get(), fc, options.channels);
-        frames -= fc;
+    if (options.profile) {
+        player.GetProfile().Report(stderr);
+    }
+    if (options.hotspots) {
+        player.GetCPUProfile().Report(stderr);
+    }
+    if (!options.flamegraph.empty() && player.GetCPUProfile().IsEnabled()) {
+        FILE *fg = fopen(options.flamegraph.c_str(), "w");
+        if (fg == NULL) {
+            fprintf(stderr, "Error opening %s: %s\n", options.flamegraph.c_str(), strerror(errno));
+            return 1;
+        }
+        player.GetCPUProfile().WriteCollapsed(fg);
+        fclose(fg);
+    }
+    if (!options.loudness.empty()) {
+        const xgm::LoudnessMeter &meter = player.GetLoudness();
+        double lufs = meter.GetIntegrated();
+        double peak = meter.GetTruePeak();
+        json loudness = json::object();
+        loudness["track"] = i + 1;
+        loudness["seconds"] = meter.GetSeconds();
+        /* null when the track is silent or shorter than one 400ms block */
+        loudness["integrated_lufs"] = std::isfinite(lufs) ? json(lufs) : json(nullptr);
+        loudness["true_peak_dbtp"] = peak > 0.0 ? json(20.0 * std::log10(peak)) : json(nullptr);
+        loudness["sample_peak"] = meter.GetSamplePeak();
+        loudness["replaygain_track_gain_db"] = std::isfinite(lufs) ? json(kReplayGainLufs - lufs) : json(nullptr);
+        loudness["replaygain_track_peak"] = peak;
+
+        if (!WriteJson(options.loudness, loudness)) return 1;
+    }
+    if (!options.overview.empty()) {
+        player.GetOverview().Finish();
+        if (!WriteJson(options.overview, OverviewJson(player.GetOverview(), i + 1, options.samplerate))) return 1;
     }
-
-    fclose(f);
 
     return EXIT_SUCCESS;
 }
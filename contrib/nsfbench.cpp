@@ -0,0 +1,284 @@
+/* benchmark harness for the xgm library
+ * 1. measures Load+Reset latency and heap per player instance
+ * 2. measures Render and Skip throughput over a matrix of
+ *    QUALITY / sample rate / channel settings
+ * 3. prints the results as JSON
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <getopt.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "nlohmann/json.hpp"
+#include "../xgm/xgm.h"
+#include "../xgm/version.h"
+
+namespace {
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+std::string_view progname;
+
+constexpr const unsigned int kFramesToBuffer = 4096;
+
+struct NsfBenchOptions {
+    double seconds = 10.0;
+    int track = 1;
+    std::vector<int> qualities = { 1, 10, 40 };
+    std::vector<int> rates = { 44100, 48000, 96000 };
+    std::vector<int> channels = { 1, 2 };
+    bool skip = true;
+    std::string output;
+};
+
+void Usage(std::ostream &output, int exit_code) {
+    NsfBenchOptions defaults;
+    output
+        << "Usage: " << progname << " [options] /path/to/nsf[e] ..." << std::endl
+        << R"(Measure NSFPlay render performance and print the results as JSON.
+
+For each file, every combination of quality, sample rate and channel count
+is rendered for the given length of emulated time on a fresh player. Skip
+is measured once per quality and sample rate. Build with `make release`
+for meaningful numbers.
+
+Options:
+ -h, --help              Show this help message.
+ -l, --seconds=)" << defaults.seconds << R"(        Emulated seconds to render per case.
+ -t, --track=)" << defaults.track << R"(             Track number, starting with 1.
+ -q, --quality=1,10,40   QUALITY settings to test.
+ -s, --rates=44100,48000,96000
+                         Sample rates to test.
+ -c, --channels=1,2      Channel counts to test.
+ -n, --no_skip           Do not measure Skip.
+ -o, --output=<file>     Write the JSON to a file instead of stdout.
+)";
+    std::exit(exit_code);
+}
+
+std::vector<int> ParseList(const char *arg) {
+    std::vector<int> list;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) list.push_back(std::stoi(item));
+    }
+    return list;
+}
+
+NsfBenchOptions ParseOptions(int *argc, char ***argv) {
+    static constexpr struct option longopts[] = {
+        { "help", no_argument, nullptr, 'h' },
+        { "seconds", required_argument, nullptr, 'l' },
+        { "track", required_argument, nullptr, 't' },
+        { "quality", required_argument, nullptr, 'q' },
+        { "rates", required_argument, nullptr, 's' },
+        { "channels", required_argument, nullptr, 'c' },
+        { "no_skip", no_argument, nullptr, 'n' },
+        { "output", required_argument, nullptr, 'o' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    NsfBenchOptions options;
+    int ch = 0;
+    while ((ch = getopt_long(*argc, *argv, "hl:t:q:s:c:no:", longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'l':
+            options.seconds = std::stod(optarg);
+            break;
+        case 't':
+            options.track = std::stoi(optarg);
+            break;
+        case 'q':
+            options.qualities = ParseList(optarg);
+            break;
+        case 's':
+            options.rates = ParseList(optarg);
+            break;
+        case 'c':
+            options.channels = ParseList(optarg);
+            break;
+        case 'n':
+            options.skip = false;
+            break;
+        case 'o':
+            options.output = optarg;
+            break;
+        case 'h':
+            Usage(std::cout, EXIT_SUCCESS);
+        default:
+            Usage(std::cerr, EXIT_FAILURE);
+        }
+    }
+    *argc -= optind;
+    *argv += optind;
+    return options;
+}
+
+// bytes currently allocated from the heap, -1 if unknown
+long long HeapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return (long long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+json ChipList(const xgm::NSF &nsf) {
+    json chips = json::array({ "APU" });
+    if (nsf.use_vrc6) chips.push_back("VRC6");
+    if (nsf.use_vrc7) chips.push_back("VRC7");
+    if (nsf.use_fds) chips.push_back("FDS");
+    if (nsf.use_mmc5) chips.push_back("MMC5");
+    if (nsf.use_n106) chips.push_back("N163");
+    if (nsf.use_fme7) chips.push_back("5B");
+    return chips;
+}
+
+// one NSF loaded into a ready-to-render player
+struct Instance {
+    xgm::NSF nsf;
+    xgm::NSFPlayerConfig config;
+    xgm::NSFPlayer player;
+};
+
+double Seconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+std::unique_ptr<Instance> Start(const char *path, int track, int quality, int rate, int channels,
+                                double *load_seconds) {
+    auto start = Clock::now();
+    std::unique_ptr<Instance> in(new Instance);
+    if (!in->nsf.LoadFile(path)) return nullptr;
+
+    in->config["QUALITY"] = quality;
+    in->config["MASTER_VOLUME"] = 256;
+    in->config["APU2_OPTION5"] = 0; /* disable randomized noise phase at reset */
+    in->config["APU2_OPTION7"] = 0; /* disable randomized tri phase at reset */
+    in->config["PLAY_ADVANCE"] = 1; /* never fade out or stop */
+    in->config["AUTO_STOP"] = 0;
+    in->config["AUTO_DETECT"] = 0;
+
+    in->player.SetConfig(&in->config);
+    if (!in->player.Load(&in->nsf)) return nullptr;
+    in->player.SetPlayFreq(rate);
+    in->player.SetChannels(channels);
+    if (!in->nsf.playlist_mode) in->player.SetSong(track - 1);
+    in->player.Reset();
+    if (load_seconds) *load_seconds = Seconds(start, Clock::now());
+    return in;
+}
+
+json RunCase(const char *path, const NsfBenchOptions &options, const char *mode,
+             int quality, int rate, int channels) {
+    std::unique_ptr<Instance> in = Start(path, options.track, quality, rate, channels, nullptr);
+    if (!in) return json::object({ { "mode", mode }, { "error", "could not load" } });
+    std::unique_ptr<xgm::INT16[]> buf(new xgm::INT16[kFramesToBuffer * channels]);
+
+    uint64_t frames = uint64_t(options.seconds * rate);
+    uint64_t left = frames;
+    bool render = (std::strcmp(mode, "render") == 0);
+
+    auto start = Clock::now();
+    while (left) {
+        unsigned int fc = (left < kFramesToBuffer) ? (unsigned int)left : kFramesToBuffer;
+        if (render) in->player.Render(buf.get(), fc);
+        else        in->player.Skip(fc);
+        left -= fc;
+    }
+    double elapsed = Seconds(start, Clock::now());
+
+    json result = json::object();
+    result["mode"] = mode;
+    result["quality"] = quality;
+    result["rate"] = rate;
+    result["channels"] = channels;
+    result["samples"] = frames;
+    result["seconds"] = elapsed;
+    result["samples_per_sec"] = elapsed > 0.0 ? double(frames) / elapsed : 0.0;
+    result["realtime"] = elapsed > 0.0 ? options.seconds / elapsed : 0.0;
+    return result;
+}
+
+json BenchFile(const char *path, const NsfBenchOptions &options) {
+    json file = json::object();
+    file["file"] = path;
+    file["track"] = options.track;
+
+    // startup latency and memory, at default settings
+    long long heap_before = HeapInUse();
+    double load_seconds = 0.0;
+    std::unique_ptr<Instance> in = Start(path, options.track, 10, xgm::DEFAULT_RATE, 2, &load_seconds);
+    long long heap_after = HeapInUse();
+    if (!in) {
+        file["error"] = "could not load";
+        return file;
+    }
+    file["chips"] = ChipList(in->nsf);
+    file["load_reset_ms"] = load_seconds * 1000.0;
+    file["instance_bytes"] = sizeof(Instance);
+    file["heap_bytes"] = (heap_before >= 0) ? json(heap_after - heap_before) : json(nullptr);
+    in.reset();
+
+    json cases = json::array();
+    for (int quality : options.qualities) {
+        for (int rate : options.rates) {
+            for (int channels : options.channels) {
+                cases.push_back(RunCase(path, options, "render", quality, rate, channels));
+            }
+            if (options.skip) {
+                cases.push_back(RunCase(path, options, "skip", quality, rate, 1));
+            }
+        }
+    }
+    file["cases"] = cases;
+    return file;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    progname = argv[0];
+    NsfBenchOptions options = ParseOptions(&argc, &argv);
+
+    if (argc < 1) Usage(std::cerr, EXIT_FAILURE);
+
+    json report = json::object();
+    report["version"] = NSFPLAY_VERSION;
+    report["profile_build"] = xgm::Profiler::Enabled();
+    report["seconds"] = options.seconds;
+
+    json files = json::array();
+    for (int i = 0; i < argc; ++i) {
+        std::cerr << "bench: " << argv[i] << std::endl;
+        files.push_back(BenchFile(argv[i], options));
+    }
+    report["files"] = files;
+
+    if (options.output.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        FILE *f = std::fopen(options.output.c_str(), "w");
+        if (f == nullptr) {
+            std::perror(options.output.c_str());
+            return EXIT_FAILURE;
+        }
+        std::string s = report.dump(2);
+        std::fprintf(f, "%s\n", s.c_str());
+        std::fclose(f);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/* writes the synthetic stress-test NSFs from nsfsynth
+ * as a self-contained corpus for nsfbench and regression runs
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <getopt.h>
+
+#include "nsfsynth.h"
+
+namespace {
+
+std::string_view progname;
+
+struct NsfGenOptions {
+    std::string output = ".";
+    nsfsynth::Format format = nsfsynth::Format::kAuto;
+    bool list = false;
+};
+
+void Usage(std::ostream &output, int exit_code) {
+    output
+        << "Usage: " << progname << " [options] [scenario ...]" << std::endl
+        << R"(Write synthetic NSF images that stress one part of the emulator each.
+
+Without arguments every scenario is written, as <output>/<scenario>.nsf[e].
+
+Options:
+ -h, --help              Show this help message.
+ -l, --list              List the scenarios and exit.
+ -o, --output=.          Output directory.
+ -f, --format=auto       nsf, nsf2, nsfe or auto. auto writes NSF2 only when
+                         a scenario needs NSF2 features or the VRC7 variant,
+                         nsf drops them.
+)";
+    std::exit(exit_code);
+}
+
+nsfsynth::Format ParseFormat(std::string_view s) {
+    if (s == "auto") return nsfsynth::Format::kAuto;
+    if (s == "nsf") return nsfsynth::Format::kNsf;
+    if (s == "nsf2") return nsfsynth::Format::kNsf2;
+    if (s == "nsfe") return nsfsynth::Format::kNsfe;
+    std::cerr << "unknown format: " << s << std::endl;
+    Usage(std::cerr, EXIT_FAILURE);
+    return nsfsynth::Format::kAuto;
+}
+
+NsfGenOptions ParseOptions(int *argc, char ***argv) {
+    static constexpr struct option longopts[] = {
+        { "help", no_argument, nullptr, 'h' },
+        { "list", no_argument, nullptr, 'l' },
+        { "output", required_argument, nullptr, 'o' },
+        { "format", required_argument, nullptr, 'f' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    NsfGenOptions options;
+    int ch = 0;
+    while ((ch = getopt_long(*argc, *argv, "hlo:f:", longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'l':
+            options.list = true;
+            break;
+        case 'o':
+            options.output = optarg;
+            break;
+        case 'f':
+            options.format = ParseFormat(optarg);
+            break;
+        case 'h':
+            Usage(std::cout, EXIT_SUCCESS);
+        default:
+            Usage(std::cerr, EXIT_FAILURE);
+        }
+    }
+    *argc -= optind;
+    *argv += optind;
+    return options;
+}
+
+bool WriteScenario(const nsfsynth::Scenario &scenario, const NsfGenOptions &options) {
+    nsfsynth::Image image = scenario.build();
+    nsfsynth::Format format = options.format;
+    if (format == nsfsynth::Format::kAuto) format = nsfsynth::PreferredFormat(image);
+    if (format == nsfsynth::Format::kNsf && nsfsynth::PreferredFormat(image) != format) {
+        std::cerr << scenario.name << ": NSF2 features dropped in NSF format" << std::endl;
+    }
+    std::vector<uint8_t> bytes = nsfsynth::Write(image, format);
+
+    std::string path = options.output + "/" + scenario.name + "." + nsfsynth::Extension(format);
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        std::perror(path.c_str());
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        std::perror(path.c_str());
+        return false;
+    }
+    std::cout << path << std::endl;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    progname = argv[0];
+    NsfGenOptions options = ParseOptions(&argc, &argv);
+
+    if (options.list) {
+        for (const nsfsynth::Scenario &s : nsfsynth::Scenarios()) {
+            std::printf("%-8s %s\n", s.name, s.description);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<const nsfsynth::Scenario *> selected;
+    for (int i = 0; i < argc; ++i) {
+        const nsfsynth::Scenario *s = nsfsynth::FindScenario(argv[i]);
+        if (s == nullptr) {
+            std::cerr << "unknown scenario: " << argv[i] << " (see --list)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        selected.push_back(s);
+    }
+    if (selected.empty()) {
+        for (const nsfsynth::Scenario &s : nsfsynth::Scenarios()) selected.push_back(&s);
+    }
+
+    try {
+        for (const nsfsynth::Scenario *s : selected) {
+            if (!WriteScenario(*s, options)) return EXIT_FAILURE;
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "nsfgen: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -5,29 +5,41 @@
 #include <string>
 #include <cstdlib>
 #include <cstdio>
-#include <cerrno>
-#include <cassert>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <getopt.h>
-#include <iconv.h>
 
 #include "nlohmann/json.hpp"
+#include "toutf8.h"
 #include "../xgm/xgm.h"
 
 
 namespace {
 
 using json = nlohmann::json;
+using nsfplay::ToUTF8;
 
 std::string_view progname;
 
 struct NsfMetaOptions {
   std::string encoding;
+  bool ndjson = false;
+  int jobs = 0;  // 0 = one per hardware thread
+  std::vector<std::string> lists;
 };
 
 void Usage(std::ostream &output, int exit_code) {
     output
         << "Usage: " << progname << " [options] /path/to/nsf[e]" << std::endl
+        << "       " << progname << " --ndjson [options] (file | directory)..." << std::endl
         << R"(Output metadata from an NSF[e] in JSON format.
 
 The generated JSON will be an array of objects, one for each track. For example:
@@ -40,9 +52,24 @@ The generated JSON will be an array of objects, one for each track. For example:
         }
     ]
 
+With --ndjson, any number of files and directories (searched recursively for
+.nsf and .nsfe files) are scanned on several threads, and one JSON object per
+file is written per line as soon as it is read, in no particular order. Only
+the header and metadata chunks are read, never the program:
+
+    {"path":"a.nsfe","format":"NSFe","title":"...","songs":2,"start":1,
+     "chips":["VRC6"],"regions":["NTSC"],"playlist":[2,1],
+     "tracks":[{"track":1,"title":"...","play_time_ms":90000}],"mixe":{}}
+
+A file that can't be read gives {"path":...,"error":...} and exit status 1.
+
 Options:
  -h, --help              Show this help message.
  -e, --encoding=UTF-8    The encoding of the metadata fetched from the NSF file.
+ -n, --ndjson            Scan many files, see above.
+ -f, --files-from=<file> Also scan the paths listed in a file, one per line
+                         (- for stdin). Implies --ndjson.
+ -j, --jobs=<number>     Threads for --ndjson. Default: one per CPU.
 )";
         std::exit(exit_code);
 }
@@ -51,15 +78,28 @@ NsfMetaOptions ParseOptions(int *argc, char ***argv) {
     static constexpr struct option longopts[] = {
         { "help", no_argument, nullptr, 'h' },
         { "encoding", required_argument, nullptr, 'e' },
+        { "ndjson", no_argument, nullptr, 'n' },
+        { "files-from", required_argument, nullptr, 'f' },
+        { "jobs", required_argument, nullptr, 'j' },
         { nullptr, 0, nullptr, 0 }
     };
     NsfMetaOptions options;
     int ch = 0;
-    while ((ch = getopt_long(*argc, *argv, "he:", longopts, NULL)) != -1) {
+    while ((ch = getopt_long(*argc, *argv, "he:nf:j:", longopts, NULL)) != -1) {
         switch (ch) {
         case 'e':
             options.encoding = optarg;
             break;
+        case 'n':
+            options.ndjson = true;
+            break;
+        case 'f':
+            options.lists.push_back(optarg);
+            options.ndjson = true;
+            break;
+        case 'j':
+            options.jobs = std::max(1, std::atoi(optarg));
+            break;
         case 'h':
             Usage(std::cout, EXIT_SUCCESS);
         default:
@@ -71,103 +111,158 @@ NsfMetaOptions ParseOptions(int *argc, char ***argv) {
     return options;
 }
 
-const iconv_t kFailedIconvT = reinterpret_cast<iconv_t>(-1);
-
-class ToUTF8 {
-public:
-    ToUTF8() = default;
+bool IsNsfName(const std::filesystem::path &path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return ext == ".nsf" || ext == ".nsfe";
+}
 
-    ToUTF8(std::string_view input_encoding) {
-        conv_ = iconv_open("UTF-8", input_encoding.data());
-        if (conv_ == kFailedIconvT) {
-            std::perror("iconv_open");
-            std::exit(EXIT_FAILURE);
+// Expands directories into the NSF[e] files below them.
+void AddPath(const std::string &path, std::vector<std::string> *paths) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        paths->push_back(path);
+        return;
+    }
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (std::filesystem::recursive_directory_iterator it(path, options, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && IsNsfName(it->path())) {
+            paths->push_back(it->path().string());
         }
     }
+}
 
-    ~ToUTF8() {
-        if (conv_ == kFailedIconvT) return;
-        if (iconv_close(conv_) == -1) {
-            std::perror("iconv");
-            std::exit(EXIT_FAILURE);
-        }
+// iconv only for strings that aren't plain ASCII. One bad string must not
+// stop a whole scan, so invalid bytes become U+FFFD instead.
+std::string Text(ToUTF8 &utf8, std::string_view str) {
+    bool ascii = true;
+    for (unsigned char c : str) {
+        if (c & 0x80) ascii = false;
     }
+    if (ascii) return std::string(str);
+
+    std::string out;
+    if (utf8.TryConvert(str, &out)) return out;
+    out.clear();
+    for (unsigned char c : str) {
+        if (c & 0x80) out += "\xEF\xBF\xBD";
+        else out += char(c);
+    }
+    return out;
+}
 
-    ToUTF8(const ToUTF8 &) = delete;
-    ToUTF8 &operator=(const ToUTF8 &) = delete;
+json ScanFile(const std::string &path, xgm::NSF &nsf, ToUTF8 &utf8) {
+    static const char *const kChips[] = { "VRC6", "VRC7", "FDS", "MMC5", "N163", "5B" };
+    static const char *const kRegions[] = { "NTSC", "PAL", "Dendy" };
+    static const char *const kMixe[xgm::NSFE_MIXES] = { "APU1", "APU2", "VRC6", "VRC7", "FDS", "MMC5", "N163", "5B" };
 
-    ToUTF8(ToUTF8 &&o) : ToUTF8() {
-        swap(*this, o);
+    json j = json::object();
+    j["path"] = path;
+    if (!nsf.LoadMetadata(path.c_str())) {
+        j["error"] = nsf.LoadError();
+        return j;
     }
 
-    ToUTF8 &operator=(ToUTF8 &&o) {
-        swap(*this, o);
-        return *this;
+    bool nsfe = std::string_view(nsf.magic) != "NESM";
+    j["format"] = nsfe ? "NSFe" : nsf.version >= 2 ? "NSF2" : "NSF";
+    if (std::string_view title(nsf.title); !title.empty()) j["title"] = Text(utf8, title);
+    if (std::string_view artist(nsf.artist); !artist.empty()) j["artist"] = Text(utf8, artist);
+    if (std::string_view copyright(nsf.copyright); !copyright.empty()) j["copyright"] = Text(utf8, copyright);
+    if (std::string_view ripper(nsf.ripper); !ripper.empty()) j["ripper"] = Text(utf8, ripper);
+    if (nsf.text && nsf.text_len) {
+        j["text"] = Text(utf8, std::string_view(nsf.text, strnlen(nsf.text, nsf.text_len)));
     }
+    j["songs"] = nsf.songs;
+    j["start"] = nsf.start;
 
-    friend void swap(ToUTF8 &a, ToUTF8 &b) {
-        using std::swap;
-        swap(a.conv_, b.conv_);
+    json chips = json::array();
+    for (int i = 0; i < 6; ++i) {
+        if (nsf.soundchip & (1 << i)) chips.push_back(kChips[i]);
     }
+    j["chips"] = std::move(chips);
+    json regions = json::array();
+    for (int i = 0; i < 3; ++i) {
+        if (nsf.regn & (1 << i)) regions.push_back(kRegions[i]);
+    }
+    j["regions"] = std::move(regions);
+    if (nsf.regn_pref >= 0 && nsf.regn_pref < 3) j["preferred_region"] = kRegions[nsf.regn_pref];
 
-    std::string Convert(std::string_view str) {
-        std::string out;
-
-        static constexpr size_t kBufferSize = BUFSIZ;
-
-        char *inbuf = const_cast<char*>(str.data());
-        size_t inbytesleft = str.length();
-        char outbuf[kBufferSize];
-        size_t outbytesleft = kBufferSize;
-        char *outptr = outbuf;
-
-        // Write out the byte sequence to get into the initial state (if
-        // necessary).
-        bool done = Convert(/*inbuf=*/nullptr, /*inbytesleft=*/nullptr, &outptr,
-                            &outbytesleft);
-        assert(done);
-
-        do {
-            done = Convert(&inbuf, &inbytesleft, &outptr, &outbytesleft);
-            out.append(outbuf, kBufferSize - outbytesleft);
-            outptr = outbuf;
-            outbytesleft = kBufferSize;
-        } while(!done);
+    if (nsf.nsfe_plst) {
+        json playlist = json::array();
+        for (int i = 0; i < nsf.nsfe_plst_size; ++i) playlist.push_back(nsf.nsfe_plst[i] + 1);
+        j["playlist"] = std::move(playlist);
+    }
 
-        // Flush partially converted input.
-        done = Convert(/*inbuf=*/nullptr, /*inbytesleft=*/nullptr, &outptr,
-                       &outbytesleft);
-        assert(done);
+    json tracks = json::array();
+    for (int i = 0; i < nsf.songs; ++i) {
+        const xgm::NSFE_Entry &e = nsf.nsfe_entry[i];
+        json t = json::object();
+        if (e.tlbl && e.tlbl[0]) t["title"] = Text(utf8, e.tlbl);
+        if (e.taut && e.taut[0]) t["author"] = Text(utf8, e.taut);
+        if (e.time >= 0) t["play_time_ms"] = e.time;
+        if (e.fade >= 0) t["fade_ms"] = e.fade;
+        if (e.psfx) t["sound_effect"] = true;
+        if (t.empty()) continue;
+        t["track"] = i + 1;
+        tracks.push_back(std::move(t));
+    }
+    j["tracks"] = std::move(tracks);
 
-        return out;
+    json mixe = json::object();
+    for (unsigned int i = 0; i < xgm::NSFE_MIXES; ++i) {
+        if (nsf.nsfe_mixe[i] != xgm::NSFE_MIXE_DEFAULT) mixe[kMixe[i]] = nsf.nsfe_mixe[i];
     }
+    j["mixe"] = std::move(mixe);
+    return j;
+}
 
-private:
-    // Returns true when the input has been fully converted.
-    bool Convert(char **inbuf, size_t *inbytesleft, char **outbuf,
-                 size_t *outbytesleft) {
-        size_t orig_ibl = 0;
-        if (inbytesleft) orig_ibl = *inbytesleft;
-        size_t ibl = orig_ibl;
-
-        size_t orig_obl = 0;
-        if (outbytesleft) orig_obl = *outbytesleft;
-        size_t obl = orig_obl;
-
-        assert(conv_ != kFailedIconvT);
-        size_t nconv = iconv(conv_, inbuf, &ibl, outbuf, &obl);
-        if (nconv == -1 && (errno != E2BIG || obl == orig_obl)) {
-            std::perror("iconv");
-            std::exit(EXIT_FAILURE);
+int ScanBatch(const NsfMetaOptions &options, int argc, char *argv[]) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < argc; ++i) AddPath(argv[i], &paths);
+    for (const std::string &list : options.lists) {
+        std::ifstream file;
+        if (list != "-") {
+            file.open(list);
+            if (!file) {
+                std::cerr << "Error opening '" << list << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::istream &in = list == "-" ? std::cin : file;
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) AddPath(line, &paths);
         }
-
-        if (outbytesleft) *outbytesleft = obl;
-        if (inbytesleft) *inbytesleft = ibl;
-        return ibl == 0;
     }
 
-    iconv_t conv_ = kFailedIconvT;
-};
+    size_t jobs = options.jobs > 0 ? options.jobs : std::thread::hardware_concurrency();
+    jobs = std::max<size_t>(1, std::min(jobs, paths.size()));
+
+    // each thread takes the next path until none are left
+    std::atomic<size_t> next(0);
+    std::atomic<bool> ok(true);
+    std::mutex output_mutex;
+    auto job = [&] {
+        ToUTF8 utf8(options.encoding);
+        xgm::NSF nsf;
+        for (size_t k; (k = next++) < paths.size();) {
+            json j = ScanFile(paths[k], nsf, utf8);
+            if (j.contains("error")) ok = false;
+            std::string line = j.dump();
+            line += '\n';
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::fwrite(line.data(), 1, line.size(), stdout);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < jobs; ++t) threads.emplace_back(job);
+    job();
+    for (std::thread &t : threads) t.join();
+    std::fflush(stdout);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 }  // namespace
 
@@ -175,6 +270,7 @@ int main(int argc, char *argv[]) {
     progname = argv[0];
     NsfMetaOptions options = ParseOptions(&argc, &argv);
 
+    if (options.ndjson) return ScanBatch(options, argc, argv);
     if (argc != 1) Usage(std::cerr, EXIT_FAILURE);
     std::string_view nsf_path(argv[0]);
 
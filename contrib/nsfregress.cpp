@@ -0,0 +1,455 @@
+/* golden-audio regression harness for the xgm library
+ * 1. renders each NSF track with fixed settings
+ * 2. hashes the PCM per one-second window and compares against
+ *    the hashes recorded in a golden JSON file
+ * 3. cases that may legitimately differ (variants) are instead compared
+ *    against their exact reference case by per-window SNR
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <getopt.h>
+
+#include "nlohmann/json.hpp"
+#include "../xgm/xgm.h"
+#include "../xgm/version.h"
+
+namespace {
+
+using json = nlohmann::json;
+
+std::string_view progname;
+
+constexpr const unsigned int kFramesToBuffer = 4096;
+constexpr const int kRate = 48000;
+constexpr const int kChannels = 2;
+
+// KEY=VALUE overrides plus the SNR (dB) the variant must keep against the base case
+struct Variant {
+    std::map<std::string, int> config;
+    double min_snr_db;
+};
+
+struct NsfRegressOptions {
+    bool record = false;
+    double seconds = 5.0;
+    int track = 1;
+    std::map<std::string, int> config;
+    std::vector<Variant> variants;
+    std::string dump;
+};
+
+void Usage(std::ostream &output, int exit_code) {
+    NsfRegressOptions defaults;
+    output
+        << "Usage: " << progname << " [options] golden.json" << std::endl
+        << "       " << progname << " --record [options] golden.json /path/to/nsf[e] ..." << std::endl
+        << R"(Check NSFPlay output against golden per-second PCM hashes.
+
+Every case is rendered at 48000Hz stereo with fixed settings. Exact cases
+must match their recorded hashes bit for bit, the first differing window
+is reported. Variant cases are rendered alongside their exact base case
+and must keep a minimum SNR against it in every window. The exit status
+is non-zero if any case fails.
+
+Options:
+ -h, --help              Show this help message.
+ -r, --record            Render the given files and write golden.json.
+ -l, --seconds=)" << defaults.seconds << R"(         Seconds to render per case (record only).
+ -t, --track=)" << defaults.track << R"(             Track number, starting with 1 (record only).
+ -c, --config=KEY=VALUE  Config override for every case (record only).
+ -v, --variant=KEY=VALUE[,KEY=VALUE...]:DB
+                         Also record a variant of every file with these
+                         overrides, passing with at least DB dB SNR.
+ -d, --dump=<dir>        Write the rendered streams as WAV. When recording,
+                         <case>.wav for every case; when checking, failing
+                         cases write <case>.new.wav (and <case>.ref.wav
+                         for the base of a variant) and are compared
+                         sample by sample with an earlier <case>.wav.
+)";
+    std::exit(exit_code);
+}
+
+void ParseAssignment(const std::string &item, std::map<std::string, int> *config) {
+    size_t eq = item.find('=');
+    if (eq == std::string::npos || eq == 0) {
+        std::cerr << "expected KEY=VALUE: " << item << std::endl;
+        Usage(std::cerr, EXIT_FAILURE);
+    }
+    (*config)[item.substr(0, eq)] = std::stoi(item.substr(eq + 1));
+}
+
+Variant ParseVariant(const std::string &arg) {
+    size_t colon = arg.rfind(':');
+    if (colon == std::string::npos) {
+        std::cerr << "expected KEY=VALUE[,KEY=VALUE...]:DB: " << arg << std::endl;
+        Usage(std::cerr, EXIT_FAILURE);
+    }
+    Variant v;
+    v.min_snr_db = std::stod(arg.substr(colon + 1));
+    std::stringstream ss(arg.substr(0, colon));
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) ParseAssignment(item, &v.config);
+    }
+    return v;
+}
+
+NsfRegressOptions ParseOptions(int *argc, char ***argv) {
+    static constexpr struct option longopts[] = {
+        { "help", no_argument, nullptr, 'h' },
+        { "record", no_argument, nullptr, 'r' },
+        { "seconds", required_argument, nullptr, 'l' },
+        { "track", required_argument, nullptr, 't' },
+        { "config", required_argument, nullptr, 'c' },
+        { "variant", required_argument, nullptr, 'v' },
+        { "dump", required_argument, nullptr, 'd' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    NsfRegressOptions options;
+    int ch = 0;
+    while ((ch = getopt_long(*argc, *argv, "hrl:t:c:v:d:", longopts, NULL)) != -1) {
+        switch (ch) {
+        case 'r':
+            options.record = true;
+            break;
+        case 'l':
+            options.seconds = std::stod(optarg);
+            break;
+        case 't':
+            options.track = std::stoi(optarg);
+            break;
+        case 'c':
+            ParseAssignment(optarg, &options.config);
+            break;
+        case 'v':
+            options.variants.push_back(ParseVariant(optarg));
+            break;
+        case 'd':
+            options.dump = optarg;
+            break;
+        case 'h':
+            Usage(std::cout, EXIT_SUCCESS);
+        default:
+            Usage(std::cerr, EXIT_FAILURE);
+        }
+    }
+    *argc -= optind;
+    *argv += optind;
+    return options;
+}
+
+// 64-bit FNV-1a over the little-endian samples
+std::string HashWindow(const std::vector<int16_t> &pcm, size_t begin, size_t end) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = begin; i < end; ++i) {
+        uint16_t s = uint16_t(pcm[i]);
+        h = (h ^ (s & 0xFF)) * 0x100000001B3ull;
+        h = (h ^ (s >> 8)) * 0x100000001B3ull;
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return buf;
+}
+
+// interleaved samples for one case, empty if the file could not be played
+std::vector<int16_t> Render(const std::string &path, int track, const json &config, double seconds) {
+    xgm::NSF nsf;
+    xgm::NSFPlayerConfig pc;
+    xgm::NSFPlayer player;
+    if (!nsf.LoadFile(path.c_str())) return {};
+
+    pc["MASTER_VOLUME"] = 256;
+    pc["APU2_OPTION5"] = 0; /* disable randomized noise phase at reset */
+    pc["APU2_OPTION7"] = 0; /* disable randomized tri phase at reset */
+    pc["PLAY_ADVANCE"] = 1; /* never fade out or stop */
+    pc["AUTO_STOP"] = 0;
+    pc["AUTO_DETECT"] = 0;
+    for (auto it = config.begin(); it != config.end(); ++it) pc[it.key()] = it.value().get<int>();
+
+    player.SetConfig(&pc);
+    if (!player.Load(&nsf)) return {};
+    player.SetPlayFreq(kRate);
+    player.SetChannels(kChannels);
+    if (!nsf.playlist_mode) player.SetSong(track - 1);
+    player.Reset();
+
+    uint64_t left = uint64_t(seconds * kRate);
+    std::vector<int16_t> pcm(left * kChannels);
+    int16_t *out = pcm.data();
+    while (left) {
+        unsigned int fc = (left < kFramesToBuffer) ? (unsigned int)left : kFramesToBuffer;
+        player.Render(out, fc);
+        out += fc * kChannels;
+        left -= fc;
+    }
+    return pcm;
+}
+
+size_t WindowCount(const std::vector<int16_t> &pcm) {
+    size_t window = size_t(kRate) * kChannels;
+    return (pcm.size() + window - 1) / window;
+}
+
+void WindowRange(const std::vector<int16_t> &pcm, size_t w, size_t *begin, size_t *end) {
+    size_t window = size_t(kRate) * kChannels;
+    *begin = w * window;
+    *end = std::min(pcm.size(), *begin + window);
+}
+
+json Hashes(const std::vector<int16_t> &pcm) {
+    json hashes = json::array();
+    for (size_t w = 0; w < WindowCount(pcm); ++w) {
+        size_t b, e;
+        WindowRange(pcm, w, &b, &e);
+        hashes.push_back(HashWindow(pcm, b, e));
+    }
+    return hashes;
+}
+
+double Snr(const std::vector<int16_t> &ref, const std::vector<int16_t> &x, size_t begin, size_t end) {
+    double signal = 0.0, noise = 0.0;
+    for (size_t i = begin; i < end; ++i) {
+        double r = ref[i];
+        double d = r - (i < x.size() ? double(x[i]) : 0.0);
+        signal += r * r;
+        noise += d * d;
+    }
+    if (noise == 0.0) return INFINITY;
+    if (signal == 0.0) return -INFINITY;
+    return 10.0 * std::log10(signal / noise);
+}
+
+bool WriteWav(const std::string &path, const std::vector<int16_t> &pcm) {
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        std::perror(path.c_str());
+        return false;
+    }
+    uint32_t data_size = uint32_t(pcm.size() * sizeof(int16_t));
+    uint8_t h[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ',
+                      16, 0, 0, 0, 1, 0, kChannels, 0 };
+    auto put32 = [&h](int at, uint32_t v) { for (int i = 0; i < 4; ++i) h[at + i] = uint8_t(v >> (i * 8)); };
+    put32(4, data_size + 36);
+    put32(24, kRate);
+    put32(28, kRate * kChannels * sizeof(int16_t));
+    h[32] = kChannels * sizeof(int16_t);
+    h[34] = 16;
+    std::memcpy(h + 36, "data", 4);
+    put32(40, data_size);
+    bool ok = std::fwrite(h, 1, sizeof(h), f) == sizeof(h);
+    for (int16_t s : pcm) {
+        uint8_t b[2] = { uint8_t(uint16_t(s) & 0xFF), uint8_t(uint16_t(s) >> 8) };
+        ok = ok && std::fwrite(b, 1, 2, f) == 2;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) std::perror(path.c_str());
+    return ok;
+}
+
+// samples of a WAV written by WriteWav, empty if missing
+std::vector<int16_t> ReadWav(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return {};
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<int16_t> pcm;
+    for (size_t i = 44; i + 1 < bytes.size(); i += 2) {
+        pcm.push_back(int16_t(uint8_t(bytes[i]) | (uint8_t(bytes[i + 1]) << 8)));
+    }
+    return pcm;
+}
+
+std::string CaseName(const std::string &path, const std::map<std::string, int> &variant) {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos && dot > 0) name.erase(dot);
+    for (const auto &kv : variant) {
+        name += "_";
+        for (char c : kv.first) name += char(std::tolower((unsigned char)c));
+        name += std::to_string(kv.second);
+    }
+    return name;
+}
+
+int Record(const NsfRegressOptions &options, const std::string &golden, int argc, char **argv) {
+    json cases = json::array();
+    for (int i = 0; i < argc; ++i) {
+        std::string path = argv[i];
+        json config(options.config);
+        std::vector<int16_t> pcm = Render(path, options.track, config, options.seconds);
+        if (pcm.empty()) {
+            std::cerr << path << ": could not load" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string name = CaseName(path, {});
+        json c = json::object();
+        c["name"] = name;
+        c["file"] = path;
+        c["track"] = options.track;
+        c["seconds"] = options.seconds;
+        c["config"] = config;
+        c["hashes"] = Hashes(pcm);
+        cases.push_back(c);
+        if (!options.dump.empty() && !WriteWav(options.dump + "/" + name + ".wav", pcm)) return EXIT_FAILURE;
+        std::cerr << "recorded " << name << std::endl;
+
+        for (const Variant &v : options.variants) {
+            json vc = config;
+            for (const auto &kv : v.config) vc[kv.first] = kv.second;
+            std::string vname = CaseName(path, v.config);
+            json var = json::object();
+            var["name"] = vname;
+            var["file"] = path;
+            var["track"] = options.track;
+            var["seconds"] = options.seconds;
+            var["config"] = vc;
+            var["reference"] = name;
+            var["min_snr_db"] = v.min_snr_db;
+            cases.push_back(var);
+            if (!options.dump.empty()) {
+                std::vector<int16_t> vpcm = Render(path, options.track, vc, options.seconds);
+                if (!WriteWav(options.dump + "/" + vname + ".wav", vpcm)) return EXIT_FAILURE;
+            }
+            std::cerr << "recorded " << vname << std::endl;
+        }
+    }
+
+    json report = json::object();
+    report["version"] = NSFPLAY_VERSION;
+    report["rate"] = kRate;
+    report["channels"] = kChannels;
+    report["cases"] = cases;
+
+    std::ofstream out(golden);
+    if (!out) {
+        std::perror(golden.c_str());
+        return EXIT_FAILURE;
+    }
+    out << report.dump(2) << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// first sample where two streams differ, -1 if they match
+long long FirstDifference(const std::vector<int16_t> &a, const std::vector<int16_t> &b) {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i]) return (long long)i;
+    }
+    return (a.size() == b.size()) ? -1 : (long long)n;
+}
+
+void DumpFailure(const NsfRegressOptions &options, const std::string &name, const std::vector<int16_t> &pcm) {
+    std::string old_path = options.dump + "/" + name + ".wav";
+    std::string new_path = options.dump + "/" + name + ".new.wav";
+    if (!WriteWav(new_path, pcm)) return;
+    std::cout << "  wrote " << new_path << std::endl;
+    std::vector<int16_t> old_pcm = ReadWav(old_path);
+    if (old_pcm.empty()) return;
+    long long at = FirstDifference(old_pcm, pcm);
+    if (at < 0) {
+        std::cout << "  matches " << old_path << std::endl;
+        return;
+    }
+    std::cout << "  first differs from " << old_path << " at frame " << at / kChannels
+              << " (" << double(at / kChannels) / kRate << " s)" << std::endl;
+}
+
+int Check(const NsfRegressOptions &options, const std::string &golden) {
+    std::ifstream in(golden);
+    if (!in) {
+        std::perror(golden.c_str());
+        return EXIT_FAILURE;
+    }
+    json report = json::parse(in);
+
+    std::map<std::string, std::vector<int16_t>> rendered;
+    int passed = 0, failed = 0;
+    for (const json &c : report["cases"]) {
+        std::string name = c["name"];
+        std::vector<int16_t> pcm = Render(c["file"], c["track"], c["config"], c["seconds"]);
+        if (pcm.empty()) {
+            std::cout << "FAIL " << name << ": could not load " << c["file"].get<std::string>() << std::endl;
+            ++failed;
+            continue;
+        }
+
+        bool ok = true;
+        if (c.contains("hashes")) {
+            const json &hashes = c["hashes"];
+            json now = Hashes(pcm);
+            for (size_t w = 0; w < now.size() || w < hashes.size(); ++w) {
+                if (w < now.size() && w < hashes.size() && now[w] == hashes[w]) continue;
+                std::cout << "FAIL " << name << ": window " << w << " (" << w << "-" << w + 1
+                          << " s) differs from golden" << std::endl;
+                ok = false;
+                break;
+            }
+            if (!ok && !options.dump.empty()) DumpFailure(options, name, pcm);
+            rendered[name] = std::move(pcm);
+        } else {
+            std::string ref_name = c["reference"];
+            double min_snr = c["min_snr_db"];
+            auto ref = rendered.find(ref_name);
+            if (ref == rendered.end()) {
+                std::cout << "FAIL " << name << ": reference " << ref_name << " not rendered" << std::endl;
+                ++failed;
+                continue;
+            }
+            double worst = INFINITY;
+            for (size_t w = 0; w < WindowCount(ref->second); ++w) {
+                size_t b, e;
+                WindowRange(ref->second, w, &b, &e);
+                double snr = Snr(ref->second, pcm, b, e);
+                if (snr < worst) worst = snr;
+                if (ok && snr < min_snr) {
+                    std::cout << "FAIL " << name << ": window " << w << " (" << w << "-" << w + 1
+                              << " s) SNR " << snr << " dB < " << min_snr << " dB" << std::endl;
+                    ok = false;
+                }
+            }
+            if (ok) std::cout << "ok   " << name << ": worst window SNR " << worst << " dB" << std::endl;
+            if (!ok && !options.dump.empty()) {
+                WriteWav(options.dump + "/" + name + ".ref.wav", ref->second);
+                WriteWav(options.dump + "/" + name + ".new.wav", pcm);
+                std::cout << "  wrote " << options.dump << "/" << name << ".{ref,new}.wav" << std::endl;
+            }
+        }
+        if (ok && c.contains("hashes")) std::cout << "ok   " << name << std::endl;
+        if (ok) ++passed;
+        else    ++failed;
+    }
+    std::cout << passed << " passed, " << failed << " failed" << std::endl;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    progname = argv[0];
+    NsfRegressOptions options = ParseOptions(&argc, &argv);
+
+    if (argc < 1) Usage(std::cerr, EXIT_FAILURE);
+    std::string golden = argv[0];
+
+    if (options.record) {
+        if (argc < 2) Usage(std::cerr, EXIT_FAILURE);
+        return Record(options, golden, argc - 1, argv + 1);
+    }
+    if (argc != 1) Usage(std::cerr, EXIT_FAILURE);
+    return Check(options, golden);
+}
@@ -0,0 +1,716 @@
+#include "nsfsynth.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace nsfsynth {
+
+void Assembler::Org(uint16_t address, uint8_t fill) {
+    if (address < Pc()) throw std::runtime_error("org moves backwards");
+    code_.resize(address - origin_, fill);
+}
+
+void Assembler::Label(const std::string &name) {
+    if (labels_.count(name)) throw std::runtime_error("duplicate label " + name);
+    labels_[name] = Pc();
+}
+
+uint16_t Assembler::Address(const std::string &name) const {
+    auto it = labels_.find(name);
+    if (it == labels_.end()) throw std::runtime_error("undefined label " + name);
+    return it->second;
+}
+
+void Assembler::Bytes(const std::vector<uint8_t> &values) {
+    code_.insert(code_.end(), values.begin(), values.end());
+}
+
+void Assembler::ImmLo(Opcode op, const std::string &label) {
+    Byte(op);
+    fixups_.push_back({ code_.size(), kLow, label });
+    Byte(0);
+}
+
+void Assembler::ImmHi(Opcode op, const std::string &label) {
+    Byte(op);
+    fixups_.push_back({ code_.size(), kHigh, label });
+    Byte(0);
+}
+
+void Assembler::Abs(Opcode op, uint16_t address) {
+    Byte(op);
+    Byte(address & 0xFF);
+    Byte(address >> 8);
+}
+
+void Assembler::Abs(Opcode op, const std::string &label) {
+    Byte(op);
+    fixups_.push_back({ code_.size(), kAbsolute, label });
+    Byte(0);
+    Byte(0);
+}
+
+void Assembler::Branch(Opcode op, const std::string &label) {
+    Byte(op);
+    fixups_.push_back({ code_.size(), kRelative, label });
+    Byte(0);
+}
+
+void Assembler::Poke(uint16_t address, uint8_t value) {
+    Imm(LDA_IMM, value);
+    Abs(STA_ABS, address);
+}
+
+std::vector<uint8_t> Assembler::Link() const {
+    std::vector<uint8_t> out = code_;
+    for (const Fixup &f : fixups_) {
+        uint16_t target = Address(f.label);
+        switch (f.kind) {
+        case kAbsolute:
+            out[f.offset + 0] = target & 0xFF;
+            out[f.offset + 1] = target >> 8;
+            break;
+        case kRelative: {
+            int delta = int(target) - int(origin_ + f.offset + 1);
+            if (delta < -128 || delta > 127) throw std::runtime_error("branch out of range to " + f.label);
+            out[f.offset] = uint8_t(delta);
+            break;
+        }
+        case kLow:
+            out[f.offset] = target & 0xFF;
+            break;
+        case kHigh:
+            out[f.offset] = target >> 8;
+            break;
+        }
+    }
+    return out;
+}
+
+namespace {
+
+// writers
+
+void Put16(std::vector<uint8_t> *out, uint32_t v) {
+    out->push_back(v & 0xFF);
+    out->push_back((v >> 8) & 0xFF);
+}
+
+void PutString(std::vector<uint8_t> *out, const std::string &s, size_t field) {
+    for (size_t i = 0; i < field; ++i) out->push_back(i < s.size() && i + 1 < field ? uint8_t(s[i]) : 0);
+}
+
+void PutChunk(std::vector<uint8_t> *out, const char *id, const std::vector<uint8_t> &body) {
+    uint32_t size = uint32_t(body.size());
+    for (int i = 0; i < 4; ++i) out->push_back((size >> (i * 8)) & 0xFF);
+    out->insert(out->end(), id, id + 4);
+    out->insert(out->end(), body.begin(), body.end());
+}
+
+std::vector<uint8_t> WriteNsf(const Image &image, bool nsf2) {
+    std::vector<uint8_t> suffix;
+    if (nsf2 && image.vrc7_type >= 0) {
+        PutChunk(&suffix, "VRC7", { uint8_t(image.vrc7_type) });
+        PutChunk(&suffix, "NEND", {});
+    }
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'N', 'E', 'S', 'M', 0x1A });
+    out.push_back(nsf2 ? 2 : 1);
+    out.push_back(1); // songs
+    out.push_back(1); // start
+    Put16(&out, image.load);
+    Put16(&out, image.init);
+    Put16(&out, image.play);
+    PutString(&out, image.title, 32);
+    PutString(&out, image.artist, 32);
+    PutString(&out, image.copyright, 32);
+    Put16(&out, image.speed_ntsc);
+    for (int i = 0; i < 8; ++i) out.push_back(image.banked ? image.bank[i] : 0);
+    Put16(&out, 19997); // PAL speed
+    out.push_back(0);   // NTSC
+    out.push_back(image.chips);
+    out.push_back(nsf2 ? image.nsf2 : 0);
+    uint32_t suffix_offset = suffix.empty() ? 0 : uint32_t(image.data.size());
+    out.push_back(suffix_offset & 0xFF);
+    out.push_back((suffix_offset >> 8) & 0xFF);
+    out.push_back((suffix_offset >> 16) & 0xFF);
+
+    out.insert(out.end(), image.data.begin(), image.data.end());
+    out.insert(out.end(), suffix.begin(), suffix.end());
+    return out;
+}
+
+std::vector<uint8_t> WriteNsfe(const Image &image) {
+    std::vector<uint8_t> out = { 'N', 'S', 'F', 'E' };
+
+    std::vector<uint8_t> info;
+    Put16(&info, image.load);
+    Put16(&info, image.init);
+    Put16(&info, image.play);
+    info.push_back(0); // NTSC
+    info.push_back(image.chips);
+    info.push_back(1); // songs
+    info.push_back(0); // start, 0 based
+    PutChunk(&out, "INFO", info);
+    PutChunk(&out, "DATA", image.data);
+    if (image.banked) PutChunk(&out, "BANK", std::vector<uint8_t>(image.bank, image.bank + 8));
+    if (image.speed_ntsc != 16639) {
+        std::vector<uint8_t> rate;
+        Put16(&rate, image.speed_ntsc);
+        PutChunk(&out, "RATE", rate);
+    }
+    if (image.nsf2) PutChunk(&out, "NSF2", { image.nsf2 });
+    if (image.vrc7_type >= 0) PutChunk(&out, "VRC7", { uint8_t(image.vrc7_type) });
+
+    std::vector<uint8_t> auth;
+    for (const std::string *s : { &image.title, &image.artist, &image.copyright }) {
+        auth.insert(auth.end(), s->begin(), s->end());
+        auth.push_back(0);
+    }
+    auth.push_back(0); // ripper
+    PutChunk(&out, "auth", auth);
+    PutChunk(&out, "NEND", {});
+    return out;
+}
+
+// drivers
+//
+// Every driver keeps a frame counter in zero page and derives its register
+// writes from it, so the output keeps changing for as long as it plays.
+
+constexpr uint8_t kFrame = 0x00;
+constexpr uint8_t kDac = 0x01;
+
+Image Finish(Assembler &a, const char *title, uint8_t chips) {
+    Image image;
+    image.title = title;
+    image.chips = chips;
+    image.load = 0x8000;
+    image.init = a.Address("init");
+    image.play = a.Address("play");
+    image.data = a.Link();
+    return image;
+}
+
+// pulse, triangle and noise at full volume with halted length counters
+void ApuInit(Assembler &a) {
+    a.Poke(0x4015, 0x0F);
+    a.Poke(0x4000, 0xBF);
+    a.Poke(0x4001, 0x08);
+    a.Poke(0x4003, 0x01);
+    a.Poke(0x4004, 0x7F);
+    a.Poke(0x4005, 0x08);
+    a.Poke(0x4007, 0x02);
+    a.Poke(0x4008, 0xFF);
+    a.Poke(0x400B, 0x01);
+    a.Poke(0x400C, 0x3F);
+    a.Poke(0x400F, 0x08);
+}
+
+void ApuPlay(Assembler &a) {
+    a.Zp(LDA_ZP, kFrame);
+    a.Abs(STA_ABS, 0x4002);
+    a.Imm(EOR_IMM, 0xFF);
+    a.Abs(STA_ABS, 0x4006);
+    a.Op(LSR_A);
+    a.Abs(STA_ABS, 0x400A);
+    a.Imm(AND_IMM, 0x0F);
+    a.Abs(STA_ABS, 0x400E);
+}
+
+void Vrc6Init(Assembler &a) {
+    a.Poke(0x9003, 0x00);
+    a.Poke(0x9000, 0x7F);
+    a.Poke(0x9002, 0x81);
+    a.Poke(0xA000, 0x3F);
+    a.Poke(0xA002, 0x82);
+    a.Poke(0xB000, 0x2A);
+    a.Poke(0xB002, 0x81);
+}
+
+void Vrc6Play(Assembler &a) {
+    a.Zp(LDA_ZP, kFrame);
+    a.Abs(STA_ABS, 0x9001);
+    a.Op(ASL_A);
+    a.Abs(STA_ABS, 0xA001);
+    a.Imm(EOR_IMM, 0x55);
+    a.Abs(STA_ABS, 0xB001);
+}
+
+void Mmc5Init(Assembler &a) {
+    a.Poke(0x5015, 0x03);
+    a.Poke(0x5000, 0xBF);
+    a.Poke(0x5003, 0x01);
+    a.Poke(0x5004, 0x7F);
+    a.Poke(0x5007, 0x02);
+    a.Poke(0x5010, 0x00);
+}
+
+void Mmc5Play(Assembler &a) {
+    a.Zp(LDA_ZP, kFrame);
+    a.Abs(STA_ABS, 0x5002);
+    a.Imm(EOR_IMM, 0xAA);
+    a.Abs(STA_ABS, 0x5006);
+    a.Abs(STA_ABS, 0x5011); // PCM
+}
+
+void S5bWrite(Assembler &a, uint8_t reg, uint8_t value) {
+    a.Poke(0xC000, reg);
+    a.Poke(0xE000, value);
+}
+
+// three tones plus noise, channel C on the envelope
+void S5bInit(Assembler &a) {
+    S5bWrite(a, 0x07, 0x30);
+    S5bWrite(a, 0x08, 0x0F);
+    S5bWrite(a, 0x09, 0x0F);
+    S5bWrite(a, 0x0A, 0x10);
+    S5bWrite(a, 0x0B, 0x20);
+    S5bWrite(a, 0x0C, 0x00);
+    S5bWrite(a, 0x0D, 0x0E);
+    S5bWrite(a, 0x06, 0x08);
+}
+
+void S5bPlay(Assembler &a) {
+    for (uint8_t ch = 0; ch < 3; ++ch) {
+        a.Poke(0xC000, ch * 2);
+        a.Zp(LDA_ZP, kFrame);
+        a.Imm(EOR_IMM, uint8_t(ch * 0x30));
+        a.Abs(STA_ABS, 0xE000);
+    }
+}
+
+// 8 channels, each with the maximum wave length of 256 samples,
+// so the waves overlap the channel registers
+void N163Init(Assembler &a) {
+    a.Poke(0xE000, 0x00);
+    a.Poke(0xF800, 0x80); // $00 with auto-increment
+    a.Imm(LDX_IMM, 0x00);
+    a.Label("n163_wave");
+    a.Op(TXA);
+    a.Abs(STA_ABS, 0x4800);
+    a.Op(INX);
+    a.Imm(CPX_IMM, 0x40);
+    a.Branch(BNE, "n163_wave");
+    for (uint8_t ch = 0; ch < 8; ++ch) { // registers $40-$7F
+        uint8_t regs[8] = {};
+        regs[0] = uint8_t(0x11 * ch);     // frequency
+        regs[2] = uint8_t(0x08 + 0x10 * ch);
+        regs[4] = uint8_t(ch & 3);        // length 256
+        regs[7] = (ch == 7) ? 0x7F : 0x0F; // volume, $7F also selects 8 channels
+        for (uint8_t r : regs) {
+            a.Imm(LDA_IMM, r);
+            a.Abs(STA_ABS, 0x4800);
+        }
+    }
+}
+
+void N163Play(Assembler &a) {
+    for (uint8_t ch = 0; ch < 8; ++ch) {
+        a.Poke(0xF800, uint8_t(0x40 + ch * 8));
+        a.Zp(LDA_ZP, kFrame);
+        a.Op(CLC);
+        a.Imm(ADC_IMM, uint8_t(ch * 8));
+        a.Abs(STA_ABS, 0x4800);
+    }
+}
+
+// the VRC7 needs a pause after each data write on hardware
+void Vrc7Write(Assembler &a, uint8_t reg, uint8_t value) {
+    a.Poke(0x9010, reg);
+    a.Poke(0x9030, value);
+    a.Abs(JSR, "vrc7_wait");
+}
+
+void Vrc7Wait(Assembler &a) {
+    a.Label("vrc7_wait");
+    a.Imm(LDX_IMM, 0x08);
+    a.Label("vrc7_wait_loop");
+    a.Op(DEX);
+    a.Branch(BNE, "vrc7_wait_loop");
+    a.Op(RTS);
+}
+
+// six melodic channels, plus the rhythm section if rhythm is set
+void Vrc7Init(Assembler &a, bool rhythm) {
+    for (uint8_t ch = 0; ch < 6; ++ch) {
+        Vrc7Write(a, 0x30 + ch, uint8_t((ch + 1) << 4));
+        Vrc7Write(a, 0x10 + ch, uint8_t(0xAC + ch * 0x10));
+        Vrc7Write(a, 0x20 + ch, 0x19); // key on, block 4
+    }
+    if (rhythm) {
+        Vrc7Write(a, 0x16, 0x20);
+        Vrc7Write(a, 0x26, 0x05);
+        Vrc7Write(a, 0x17, 0x50);
+        Vrc7Write(a, 0x27, 0x05);
+        Vrc7Write(a, 0x18, 0xC0);
+        Vrc7Write(a, 0x28, 0x01);
+        Vrc7Write(a, 0x36, 0x00);
+        Vrc7Write(a, 0x37, 0x00);
+        Vrc7Write(a, 0x38, 0x00);
+        Vrc7Write(a, 0x0E, 0x20);
+    }
+}
+
+void Vrc7Play(Assembler &a, bool rhythm) {
+    for (uint8_t ch = 0; ch < 6; ++ch) {
+        a.Poke(0x9010, 0x10 + ch);
+        a.Zp(LDA_ZP, kFrame);
+        a.Imm(EOR_IMM, uint8_t(ch * 0x10));
+        a.Abs(STA_ABS, 0x9030);
+        a.Abs(JSR, "vrc7_wait");
+    }
+    if (rhythm) { // retrigger every drum each frame
+        Vrc7Write(a, 0x0E, 0x20);
+        Vrc7Write(a, 0x0E, 0x3F);
+    }
+}
+
+// a sine-ish wave with the modulator running and its envelope
+// sweeping up and down
+void FdsInit(Assembler &a) {
+    a.Poke(0x4023, 0x02);
+    a.Poke(0x4089, 0x80); // wave write enable
+    a.Imm(LDX_IMM, 0x00);
+    a.Label("fds_wave");
+    a.Op(TXA);
+    a.Abs(STA_ABSX, 0x4040);
+    a.Op(INX);
+    a.Imm(CPX_IMM, 0x40);
+    a.Branch(BNE, "fds_wave");
+    a.Poke(0x4089, 0x00);
+    a.Poke(0x4080, 0xA0); // volume 32, no envelope
+    a.Poke(0x4082, 0x00);
+    a.Poke(0x4083, 0x02);
+    a.Poke(0x4087, 0x80); // halt modulator to write its table
+    a.Imm(LDX_IMM, 0x00);
+    a.Label("fds_mod");
+    a.Op(TXA);
+    a.Imm(AND_IMM, 0x07);
+    a.Abs(STA_ABS, 0x4088);
+    a.Op(INX);
+    a.Imm(CPX_IMM, 0x20);
+    a.Branch(BNE, "fds_mod");
+    a.Poke(0x4085, 0x00);
+    a.Poke(0x4086, 0x40);
+    a.Poke(0x4087, 0x00);
+    a.Poke(0x408A, 0x01); // fastest envelope clock
+    a.Poke(0x4084, 0x41); // mod envelope increasing
+}
+
+void FdsPlay(Assembler &a) {
+    a.Zp(LDA_ZP, kFrame);
+    a.Abs(STA_ABS, 0x4086);
+    a.Imm(AND_IMM, 0x20);
+    a.Branch(BEQ, "fds_up");
+    a.Poke(0x4084, 0x01); // decreasing
+    a.Abs(JMP_ABS, "fds_done");
+    a.Label("fds_up");
+    a.Poke(0x4084, 0x41);
+    a.Label("fds_done");
+}
+
+Image BuildApu() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    a.Op(RTS);
+    return Finish(a, "APU sweep", 0);
+}
+
+// 4081 byte sample looping at rate $F, stealing CPU cycles the whole time
+Image BuildDmc() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    a.Poke(0x4010, 0x4F);
+    a.Poke(0x4012, 0x00); // $C000
+    a.Poke(0x4013, 0xFF);
+    a.Poke(0x4015, 0x1F);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    a.Op(RTS);
+    a.Org(0xC000);
+    uint32_t seed = 1;
+    for (int i = 0; i < 0xFF * 16 + 1; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        a.Byte(uint8_t(seed >> 16));
+    }
+    return Finish(a, "DMC max rate loop", 0);
+}
+
+Image BuildVrc6() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    Vrc6Init(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    Vrc6Play(a);
+    a.Op(RTS);
+    return Finish(a, "VRC6", kVRC6);
+}
+
+Image BuildVrc7() {
+    Assembler a(0x8000);
+    a.Label("init");
+    Vrc7Init(a, true);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    Vrc7Play(a, true);
+    a.Op(RTS);
+    Vrc7Wait(a);
+    Image image = Finish(a, "OPLL rhythm mode", kVRC7);
+    image.vrc7_type = 1; // YM2413, enables the 3 extra channels
+    return image;
+}
+
+Image BuildFds() {
+    Assembler a(0x8000);
+    a.Label("init");
+    FdsInit(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    FdsPlay(a);
+    a.Op(RTS);
+    return Finish(a, "FDS modulation sweep", kFDS);
+}
+
+Image BuildMmc5() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    Mmc5Init(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    Mmc5Play(a);
+    a.Op(RTS);
+    return Finish(a, "MMC5", kMMC5);
+}
+
+Image BuildN163() {
+    Assembler a(0x8000);
+    a.Label("init");
+    N163Init(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    N163Play(a);
+    a.Op(RTS);
+    return Finish(a, "N163 8 channels", kN163);
+}
+
+Image BuildS5b() {
+    Assembler a(0x8000);
+    a.Label("init");
+    S5bInit(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    S5bPlay(a);
+    a.Op(RTS);
+    return Finish(a, "5B tones, noise and envelope", kS5B);
+}
+
+Image BuildAll() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    Vrc6Init(a);
+    Vrc7Init(a, false);
+    FdsInit(a);
+    Mmc5Init(a);
+    N163Init(a);
+    S5bInit(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    Vrc6Play(a);
+    Vrc7Play(a, false);
+    FdsPlay(a);
+    Mmc5Play(a);
+    N163Play(a);
+    S5bPlay(a);
+    a.Op(RTS);
+    Vrc7Wait(a);
+    return Finish(a, "all expansion chips", kVRC6 | kVRC7 | kFDS | kMMC5 | kN163 | kS5B);
+}
+
+// 16 data banks plus a code bank fixed at $F000. PLAY maps a different
+// bank into every other slot 64 times per frame, reading from one and
+// calling a routine in another.
+Image BuildBanks() {
+    constexpr int kBanks = 16;
+    std::vector<uint8_t> data((kBanks + 1) * 0x1000, 0x00);
+    for (int b = 0; b < kBanks; ++b) {
+        Assembler bank(0x8000);
+        bank.Byte(uint8_t(b));                // id read back through $9000
+        bank.Imm(LDA_IMM, uint8_t(b * 0x11)); // $8001 routine
+        bank.Abs(STA_ABS, 0x4006);
+        bank.Op(RTS);
+        std::vector<uint8_t> code = bank.Link();
+        std::copy(code.begin(), code.end(), data.begin() + b * 0x1000);
+    }
+
+    Assembler a(0xF000);
+    a.Label("init");
+    ApuInit(a);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    a.Imm(LDX_IMM, 0x00);
+    a.Label("loop");
+    a.Op(TXA);
+    a.Imm(AND_IMM, 0x0F);
+    a.Abs(STA_ABS, 0x5FF8);
+    a.Imm(EOR_IMM, 0x0F);
+    a.Abs(STA_ABS, 0x5FF9);
+    a.Abs(STA_ABS, 0x5FFA);
+    a.Imm(EOR_IMM, 0x05);
+    a.Abs(STA_ABS, 0x5FFB);
+    a.Abs(STA_ABS, 0x5FFC);
+    a.Abs(STA_ABS, 0x5FFD);
+    a.Abs(STA_ABS, 0x5FFE);
+    a.Abs(LDA_ABS, 0x9000);
+    a.Abs(STA_ABS, 0x4002);
+    a.Abs(JSR, 0x8001);
+    a.Op(INX);
+    a.Imm(CPX_IMM, 0x40);
+    a.Branch(BNE, "loop");
+    a.Op(RTS);
+    std::vector<uint8_t> code = a.Link();
+    std::copy(code.begin(), code.end(), data.begin() + kBanks * 0x1000);
+
+    Image image;
+    image.title = "heavy bankswitching";
+    image.init = a.Address("init");
+    image.play = a.Address("play");
+    image.banked = true;
+    for (int i = 0; i < 7; ++i) image.bank[i] = uint8_t(i);
+    image.bank[7] = kBanks;
+    image.data = data;
+    return image;
+}
+
+// NSF2 IRQ every 128 cycles, the handler plays a saw on the DAC
+Image BuildIrq() {
+    Assembler a(0x8000);
+    a.Label("init");
+    ApuInit(a);
+    a.ImmLo(LDA_IMM, "irq");
+    a.Abs(STA_ABS, 0xFFFE);
+    a.ImmHi(LDA_IMM, "irq");
+    a.Abs(STA_ABS, 0xFFFF);
+    a.Poke(0x401B, 0x80);
+    a.Poke(0x401C, 0x00);
+    a.Poke(0x401D, 0x01);
+    a.Op(CLI);
+    a.Op(RTS);
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    a.Op(RTS);
+    a.Label("irq");
+    a.Op(PHA);
+    a.Abs(LDA_ABS, 0x401D); // acknowledge
+    a.Zp(INC_ZP, kDac);
+    a.Zp(LDA_ZP, kDac);
+    a.Imm(AND_IMM, 0x7F);
+    a.Abs(STA_ABS, 0x4011);
+    a.Op(PLA);
+    a.Op(RTI);
+    Image image = Finish(a, "NSF2 IRQ 14kHz", 0);
+    image.nsf2 = kNsf2Irq;
+    return image;
+}
+
+// the second INIT never returns and busy-waits on the frame counter,
+// feeding the DAC while it waits, PLAY arrives by NMI
+Image BuildSpin() {
+    Assembler a(0x8000);
+    a.Label("init");
+    a.Imm(CPY_IMM, 0x81);
+    a.Branch(BEQ, "main");
+    ApuInit(a);
+    a.Op(RTS);
+    a.Label("main");
+    a.Zp(LDA_ZP, kFrame);
+    a.Label("wait");
+    a.Zp(INC_ZP, kDac);
+    a.Zp(LDX_ZP, kDac);
+    a.Abs(STX_ABS, 0x4011);
+    a.Zp(CMP_ZP, kFrame);
+    a.Branch(BEQ, "wait");
+    a.Abs(JMP_ABS, "main");
+    a.Label("play");
+    a.Zp(INC_ZP, kFrame);
+    ApuPlay(a);
+    a.Op(RTS);
+    Image image = Finish(a, "non-returning INIT", 0);
+    image.nsf2 = kNsf2NonReturningInit;
+    return image;
+}
+
+}  // namespace
+
+Format PreferredFormat(const Image &image) {
+    if (image.nsf2 || image.vrc7_type >= 0) return Format::kNsf2;
+    return Format::kNsf;
+}
+
+std::vector<uint8_t> Write(const Image &image, Format format) {
+    if (format == Format::kAuto) format = PreferredFormat(image);
+    switch (format) {
+    case Format::kNsfe:
+        return WriteNsfe(image);
+    case Format::kNsf2:
+        return WriteNsf(image, true);
+    default:
+        return WriteNsf(image, false);
+    }
+}
+
+const char *Extension(Format format) {
+    return (format == Format::kNsfe) ? "nsfe" : "nsf";
+}
+
+const std::vector<Scenario> &Scenarios() {
+    static const std::vector<Scenario> scenarios = {
+        { "apu", "APU pulse, triangle and noise", BuildApu },
+        { "dmc", "DMC looping at the maximum rate, with cycle stealing", BuildDmc },
+        { "vrc6", "VRC6 pulses and saw", BuildVrc6 },
+        { "vrc7", "OPLL (YM2413) rhythm mode, all 9 channels", BuildVrc7 },
+        { "fds", "FDS wave with modulation envelope sweeps", BuildFds },
+        { "mmc5", "MMC5 pulses and PCM", BuildMmc5 },
+        { "n163", "all 8 N163 channels at the maximum wave length", BuildN163 },
+        { "s5b", "5B tones, noise and envelope", BuildS5b },
+        { "all", "every expansion chip at once", BuildAll },
+        { "banks", "bankswitching all 7 slots 64 times per frame", BuildBanks },
+        { "irq", "NSF2 IRQ every 128 cycles", BuildIrq },
+        { "spin", "NSF2 non-returning INIT spin-waiting for NMI PLAY", BuildSpin },
+    };
+    return scenarios;
+}
+
+const Scenario *FindScenario(std::string_view name) {
+    for (const Scenario &s : Scenarios()) {
+        if (name == s.name) return &s;
+    }
+    return nullptr;
+}
+
+}  // namespace nsfsynth
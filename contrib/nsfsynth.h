@@ -0,0 +1,126 @@
+/* synthetic NSF images for benchmarking and regression testing
+ * 1. a minimal 6502 assembler with labels
+ * 2. NSF / NSF2 / NSFe writers
+ * 3. a set of small drivers that stress one part of the emulator each
+ *
+ * Depends only on the standard library, so the generated corpus can be
+ * rebuilt anywhere the contrib tools build.
+ */
+
+#ifndef NSFSYNTH_H
+#define NSFSYNTH_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nsfsynth {
+
+// opcodes used by the drivers, named by addressing mode
+enum Opcode : uint8_t {
+    ADC_IMM = 0x69, AND_IMM = 0x29, ASL_A = 0x0A, CLC = 0x18, CLI = 0x58,
+    CMP_IMM = 0xC9, CMP_ZP = 0xC5, CPX_IMM = 0xE0, CPY_IMM = 0xC0,
+    DEX = 0xCA, DEY = 0x88, EOR_IMM = 0x49, INC_ZP = 0xE6, INX = 0xE8,
+    INY = 0xC8, LDA_ABS = 0xAD, LDA_ABSX = 0xBD, LDA_IMM = 0xA9,
+    LDA_ZP = 0xA5, LDX_IMM = 0xA2, LDX_ZP = 0xA6, LDY_IMM = 0xA0,
+    LSR_A = 0x4A, NOP = 0xEA, ORA_IMM = 0x09, PHA = 0x48, PLA = 0x68,
+    RTI = 0x40, RTS = 0x60, SEC = 0x38, SEI = 0x78, STA_ABS = 0x8D,
+    STA_ABSX = 0x9D, STA_ZP = 0x85, STX_ABS = 0x8E, TAX = 0xAA,
+    TXA = 0x8A, TAY = 0xA8, TYA = 0x98,
+    BCC = 0x90, BCS = 0xB0, BEQ = 0xF0, BMI = 0x30, BNE = 0xD0, BPL = 0x10,
+    JMP_ABS = 0x4C, JSR = 0x20,
+};
+
+// Assembles straight-line code at a fixed origin. Labels may be used
+// before they are defined; Link() resolves them and throws
+// std::runtime_error for undefined labels or out of range branches.
+class Assembler {
+  public:
+    explicit Assembler(uint16_t origin) : origin_(origin) {}
+
+    uint16_t Pc() const { return uint16_t(origin_ + code_.size()); }
+    void Org(uint16_t address, uint8_t fill = 0x00); // pad forward to address
+    void Label(const std::string &name);
+    uint16_t Address(const std::string &name) const;
+
+    void Byte(uint8_t value) { code_.push_back(value); }
+    void Bytes(const std::vector<uint8_t> &values);
+
+    void Op(Opcode op) { Byte(op); }
+    void Imm(Opcode op, uint8_t value) { Byte(op); Byte(value); }
+    void ImmLo(Opcode op, const std::string &label);
+    void ImmHi(Opcode op, const std::string &label);
+    void Zp(Opcode op, uint8_t address) { Byte(op); Byte(address); }
+    void Abs(Opcode op, uint16_t address);
+    void Abs(Opcode op, const std::string &label);
+    void Branch(Opcode op, const std::string &label);
+
+    // LDA #value, STA address
+    void Poke(uint16_t address, uint8_t value);
+
+    std::vector<uint8_t> Link() const;
+
+  private:
+    enum FixupKind { kAbsolute, kRelative, kLow, kHigh };
+    struct Fixup {
+        size_t offset;
+        FixupKind kind;
+        std::string label;
+    };
+
+    uint16_t origin_;
+    std::vector<uint8_t> code_;
+    std::map<std::string, uint16_t> labels_;
+    std::vector<Fixup> fixups_;
+};
+
+// NSF header soundchip bits
+enum Chip : uint8_t {
+    kVRC6 = 0x01, kVRC7 = 0x02, kFDS = 0x04, kMMC5 = 0x08, kN163 = 0x10, kS5B = 0x20,
+};
+
+// NSF2 feature bits
+enum Nsf2Flag : uint8_t {
+    kNsf2Irq = 0x10, kNsf2NonReturningInit = 0x20, kNsf2NoPlay = 0x40, kNsf2MetadataMandatory = 0x80,
+};
+
+enum class Format { kAuto, kNsf, kNsf2, kNsfe };
+
+struct Image {
+    std::string title;
+    std::string artist = "nsfgen";
+    std::string copyright = "public domain";
+    uint16_t load = 0x8000;
+    uint16_t init = 0x8000;
+    uint16_t play = 0x8000;
+    uint16_t speed_ntsc = 16639;
+    uint8_t chips = 0;
+    uint8_t nsf2 = 0;        // NSF2 feature bits, needs NSF2 or NSFe
+    int vrc7_type = -1;      // 'VRC7' chunk variant (1 = YM2413), needs NSF2 or NSFe
+    bool banked = false;
+    uint8_t bank[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::vector<uint8_t> data; // program image at the load address
+};
+
+// the plainest format that holds everything in the image
+Format PreferredFormat(const Image &image);
+
+// kNsf silently drops NSF2 bits and the VRC7 variant, kAuto uses PreferredFormat
+std::vector<uint8_t> Write(const Image &image, Format format);
+
+const char *Extension(Format format);
+
+struct Scenario {
+    const char *name;
+    const char *description;
+    Image (*build)();
+};
+
+const std::vector<Scenario> &Scenarios();
+const Scenario *FindScenario(std::string_view name);
+
+}  // namespace nsfsynth
+
+#endif
@@ -0,0 +1,305 @@
+#include "pcmsink.h"
+
+#include <cstring>
+
+#include <unistd.h>
+
+namespace pcmsink {
+
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool kLittleEndian = true;
+#else
+constexpr bool kLittleEndian = false;  // always repack
+#endif
+
+constexpr uint64_t kMaxRiffData = 0xFFFFFFFFull - 36 - 1;
+
+void PutLe(uint8_t *d, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) d[i] = uint8_t(v >> (8 * i));
+}
+
+// interleaved little-endian samples after an optional header
+class PcmFile : public Sink {
+public:
+    PcmFile(FILE *f, bool owned) : f_(f), owned_(owned) {
+        start_ = std::ftell(f_);
+    }
+
+    ~PcmFile() override {
+        if (owned_ && f_) std::fclose(f_);
+    }
+
+    bool Begin(const Format &format, uint64_t total_frames) override {
+        format_ = format;
+        announced_ = total_frames;
+        return WriteHeader(total_frames);
+    }
+
+    bool Write(const void *samples, size_t frames) override {
+        size_t count = frames * format_.channels;
+        size_t bytes = count * format_.FileBytes();
+        frames_ += frames;
+        if (kLittleEndian && format_.sample != SampleFormat::kS24) {
+            return std::fwrite(samples, 1, bytes, f_) == bytes;
+        }
+
+        pack_.resize(bytes);
+        uint8_t *d = pack_.data();
+        switch (format_.sample) {
+        case SampleFormat::kS16: {
+            const int16_t *s = static_cast<const int16_t *>(samples);
+            for (size_t i = 0; i < count; ++i, d += 2) PutLe(d, uint16_t(s[i]), 2);
+            break;
+        }
+        case SampleFormat::kS24: {
+            const int32_t *s = static_cast<const int32_t *>(samples);
+            for (size_t i = 0; i < count; ++i, d += 3) PutLe(d, uint32_t(s[i]), 3);
+            break;
+        }
+        case SampleFormat::kF32: {
+            const float *s = static_cast<const float *>(samples);
+            for (size_t i = 0; i < count; ++i, d += 4) {
+                uint32_t u;
+                std::memcpy(&u, &s[i], sizeof(u));
+                PutLe(d, u, 4);
+            }
+            break;
+        }
+        }
+        return std::fwrite(pack_.data(), 1, bytes, f_) == bytes;
+    }
+
+    bool End() override {
+        bool ok = WritePadding(DataBytes(frames_));
+        ok = (std::fflush(f_) == 0) && ok;
+        // fix the header if the length changed and the output can seek
+        if (ok && frames_ != announced_ && start_ >= 0 &&
+            std::fseek(f_, start_, SEEK_SET) == 0) {
+            ok = WriteHeader(frames_);
+            ok = (std::fseek(f_, 0, SEEK_END) == 0) && ok;
+        }
+        if (owned_) {
+            ok = (std::fclose(f_) == 0) && ok;
+            f_ = nullptr;
+        }
+        return ok;
+    }
+
+protected:
+    uint64_t DataBytes(uint64_t frames) const {
+        return frames * format_.channels * format_.FileBytes();
+    }
+
+    bool Put(const uint8_t *d, size_t size) {
+        return std::fwrite(d, 1, size, f_) == size;
+    }
+
+    virtual bool WriteHeader(uint64_t) { return true; }
+    virtual bool WritePadding(uint64_t) { return true; }
+
+    FILE *f_;
+    bool owned_;
+    long start_;  // -1 if not seekable
+    Format format_;
+    uint64_t announced_ = 0;
+    uint64_t frames_ = 0;
+    std::vector<uint8_t> pack_;
+};
+
+// PCM or IEEE float fmt chunk body, 16 bytes
+void PutFmt(uint8_t *d, const Format &format) {
+    unsigned bytes = format.FileBytes();
+    PutLe(d + 0, format.sample == SampleFormat::kF32 ? 3 : 1, 2);
+    PutLe(d + 2, format.channels, 2);
+    PutLe(d + 4, format.samplerate, 4);
+    PutLe(d + 8, uint64_t(format.samplerate) * format.channels * bytes, 4);
+    PutLe(d + 12, format.channels * bytes, 2);
+    PutLe(d + 14, bytes * 8, 2);
+}
+
+// RIFF WAVE, or RF64 (EBU Tech 3306) when the data does not fit 32 bits
+class WavFile : public PcmFile {
+public:
+    WavFile(FILE *f, bool owned, bool rf64) : PcmFile(f, true), rf64_(rf64) {}
+
+protected:
+    bool WriteHeader(uint64_t frames) override {
+        uint64_t data = DataBytes(frames);
+        uint64_t pad = data & 1;
+        // decided once, so a patched header has the same size
+        if (!header_written_ && data > kMaxRiffData) rf64_ = true;
+        header_written_ = true;
+
+        uint8_t h[80];
+        size_t n = 0;
+        if (rf64_) {
+            std::memcpy(h, "RF64\xFF\xFF\xFF\xFFWAVEds64", 16);
+            PutLe(h + 16, 28, 4);
+            PutLe(h + 20, 72 + data + pad, 8);
+            PutLe(h + 28, data, 8);
+            PutLe(h + 36, frames, 8);
+            PutLe(h + 44, 0, 4);  // no table
+            n = 48;
+        } else {
+            uint64_t riff = 36 + data + pad;
+            std::memcpy(h, "RIFF", 4);
+            PutLe(h + 4, riff > 0xFFFFFFFF ? 0xFFFFFFFF : riff, 4);
+            std::memcpy(h + 8, "WAVE", 4);
+            n = 12;
+        }
+        std::memcpy(h + n, "fmt ", 4);
+        PutLe(h + n + 4, 16, 4);
+        PutFmt(h + n + 8, format_);
+        n += 24;
+        std::memcpy(h + n, "data", 4);
+        PutLe(h + n + 4, (rf64_ || data > 0xFFFFFFFF) ? 0xFFFFFFFF : data, 4);
+        n += 8;
+        return Put(h, n);
+    }
+
+    bool WritePadding(uint64_t data) override {
+        static const uint8_t kZero[1] = { 0 };
+        return (data & 1) ? Put(kZero, 1) : true;
+    }
+
+private:
+    bool rf64_;
+    bool header_written_ = false;
+};
+
+// Sony Wave64, 64-bit sizes throughout, chunks aligned to 8 bytes
+class W64File : public PcmFile {
+public:
+    using PcmFile::PcmFile;
+
+protected:
+    bool WriteHeader(uint64_t frames) override {
+        static const uint8_t kRiff[16] = { 'r','i','f','f', 0x2E,0x91,0xCF,0x11, 0xA5,0xD6,0x28,0xDB, 0x04,0xC1,0x00,0x00 };
+        static const uint8_t kWave[16] = { 'w','a','v','e', 0xF3,0xAC,0xD3,0x11, 0x8C,0xD1,0x00,0xC0, 0x4F,0x8E,0xDB,0x8A };
+        static const uint8_t kFmt[16]  = { 'f','m','t',' ', 0xF3,0xAC,0xD3,0x11, 0x8C,0xD1,0x00,0xC0, 0x4F,0x8E,0xDB,0x8A };
+        static const uint8_t kData[16] = { 'd','a','t','a', 0xF3,0xAC,0xD3,0x11, 0x8C,0xD1,0x00,0xC0, 0x4F,0x8E,0xDB,0x8A };
+        uint64_t data = DataBytes(frames);
+        uint64_t pad = (8 - (data & 7)) & 7;
+
+        uint8_t h[104];
+        std::memcpy(h, kRiff, 16);
+        PutLe(h + 16, 104 + data + pad, 8);
+        std::memcpy(h + 24, kWave, 16);
+        std::memcpy(h + 40, kFmt, 16);
+        PutLe(h + 56, 24 + 16, 8);
+        PutFmt(h + 64, format_);
+        std::memcpy(h + 80, kData, 16);
+        PutLe(h + 96, 24 + data, 8);
+        return Put(h, sizeof(h));
+    }
+
+    bool WritePadding(uint64_t data) override {
+        static const uint8_t kZero[8] = {};
+        return Put(kZero, (8 - (data & 7)) & 7);
+    }
+};
+
+bool EndsWith(const std::string &s, const char *suffix) {
+    size_t n = std::strlen(suffix);
+    if (s.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char c = s[s.size() - n + i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != suffix[i]) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+unsigned Format::FileBytes() const {
+    switch (sample) {
+    case SampleFormat::kS24: return 3;
+    case SampleFormat::kF32: return 4;
+    default: return 2;
+    }
+}
+
+std::unique_ptr<Sink> Open(const std::string &path, Container container) {
+    if (container == Container::kAuto) {
+        if (EndsWith(path, ".raw") || EndsWith(path, ".pcm")) container = Container::kRaw;
+        else if (EndsWith(path, ".w64")) container = Container::kW64;
+        else if (EndsWith(path, ".rf64")) container = Container::kRF64;
+        else container = Container::kWav;
+    }
+
+    FILE *f = nullptr;
+    if (path == "-") {
+        // keep the real stdout for the audio and send anything else
+        // printed to stdout from now on to stderr
+        std::fflush(stdout);
+        int fd = dup(STDOUT_FILENO);
+        if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) return nullptr;
+        f = fdopen(fd, "wb");
+    } else {
+        f = std::fopen(path.c_str(), "wb");
+    }
+    if (f == nullptr) return nullptr;
+
+    switch (container) {
+    case Container::kRaw: return std::unique_ptr<Sink>(new PcmFile(f, true));
+    case Container::kW64: return std::unique_ptr<Sink>(new W64File(f, true));
+    case Container::kRF64: return std::unique_ptr<Sink>(new WavFile(f, true, true));
+    default: return std::unique_ptr<Sink>(new WavFile(f, true, false));
+    }
+}
+
+DoubleBufferedWriter::DoubleBufferedWriter(Sink *sink, const Format &format, size_t frames)
+    : sink_(sink), frame_bytes_(format.NativeBytes() * format.channels) {
+    buffer_[0].resize(frames * frame_bytes_);
+    buffer_[1].resize(frames * frame_bytes_);
+    thread_ = std::thread(&DoubleBufferedWriter::Run, this);
+}
+
+DoubleBufferedWriter::~DoubleBufferedWriter() {
+    Finish();
+}
+
+bool DoubleBufferedWriter::Commit(size_t frames) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return pending_ < 0; });
+    if (!ok_) return false;
+    pending_ = current_;
+    pending_frames_ = frames;
+    current_ ^= 1;
+    cond_.notify_all();
+    return true;
+}
+
+bool DoubleBufferedWriter::Finish() {
+    if (thread_.joinable()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return pending_ < 0; });
+            stop_ = true;
+            cond_.notify_all();
+        }
+        thread_.join();
+    }
+    return ok_;
+}
+
+void DoubleBufferedWriter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cond_.wait(lock, [this] { return pending_ >= 0 || stop_; });
+        if (pending_ < 0) return;
+        const uint8_t *data = buffer_[pending_].data();
+        size_t frames = pending_frames_;
+        lock.unlock();
+        bool ok = sink_->Write(data, frames);
+        lock.lock();
+        if (!ok) ok_ = false;
+        pending_ = -1;
+        cond_.notify_all();
+    }
+}
+
+}  // namespace pcmsink
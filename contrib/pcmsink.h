@@ -0,0 +1,87 @@
+/* streaming PCM outputs for the contrib tools
+ * 1. a Sink interface taking native-endian samples
+ * 2. raw PCM, WAV (RF64 past 4GB) and Wave64 files, or stdout
+ * 3. a double-buffered writer thread so rendering overlaps the output
+ */
+
+#ifndef PCMSINK_H
+#define PCMSINK_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pcmsink {
+
+// int16_t, int32_t holding 24 bits, or float
+enum class SampleFormat { kS16, kS24, kF32 };
+
+struct Format {
+    unsigned channels = 1;
+    unsigned samplerate = 48000;
+    SampleFormat sample = SampleFormat::kS16;
+
+    // bytes per sample in memory and in the file
+    unsigned NativeBytes() const { return sample == SampleFormat::kS16 ? 2 : 4; }
+    unsigned FileBytes() const;
+};
+
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    // Writes the header. total_frames is what the caller means to write;
+    // seekable outputs are patched by End if it turns out different.
+    virtual bool Begin(const Format &format, uint64_t total_frames) = 0;
+    // frames of interleaved native samples
+    virtual bool Write(const void *samples, size_t frames) = 0;
+    virtual bool End() = 0;
+};
+
+enum class Container { kAuto, kRaw, kWav, kRF64, kW64 };
+
+// kAuto picks by extension: .raw/.pcm, .w64, .rf64, otherwise WAV.
+// WAV switches to RF64 when the data passes 4GB. "-" writes to stdout,
+// which is then redirected to stderr so later messages stay out of the
+// audio.
+// Returns null and sets errno when the file can't be opened.
+std::unique_ptr<Sink> Open(const std::string &path, Container container);
+
+// Runs the sink's Write on its own thread. The caller renders into
+// Buffer() and passes it on with Commit, which then hands out the other
+// buffer once the previous one has been written.
+class DoubleBufferedWriter {
+public:
+    DoubleBufferedWriter(Sink *sink, const Format &format, size_t frames);
+    ~DoubleBufferedWriter();
+
+    void *Buffer() { return buffer_[current_].data(); }
+    bool Commit(size_t frames);
+    // waits for the last buffer, false if any Write failed
+    bool Finish();
+
+private:
+    void Run();
+
+    Sink *sink_;
+    unsigned frame_bytes_;
+    std::vector<uint8_t> buffer_[2];
+    int current_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    int pending_ = -1;       // buffer waiting for the writer thread
+    size_t pending_frames_ = 0;
+    bool stop_ = false;
+    bool ok_ = true;
+    std::thread thread_;
+};
+
+}  // namespace pcmsink
+
+#endif
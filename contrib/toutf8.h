@@ -0,0 +1,134 @@
+/* iconv wrapper converting NSF metadata strings to UTF-8 */
+
+#ifndef TOUTF8_H
+#define TOUTF8_H
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <iconv.h>
+
+namespace nsfplay {
+
+const iconv_t kFailedIconvT = reinterpret_cast<iconv_t>(-1);
+
+class ToUTF8 {
+public:
+    ToUTF8() = default;
+
+    ToUTF8(std::string_view input_encoding) {
+        conv_ = iconv_open("UTF-8", input_encoding.data());
+        if (conv_ == kFailedIconvT) {
+            std::perror("iconv_open");
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    ~ToUTF8() {
+        if (conv_ == kFailedIconvT) return;
+        if (iconv_close(conv_) == -1) {
+            std::perror("iconv");
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    ToUTF8(const ToUTF8 &) = delete;
+    ToUTF8 &operator=(const ToUTF8 &) = delete;
+
+    ToUTF8(ToUTF8 &&o) : ToUTF8() {
+        swap(*this, o);
+    }
+
+    ToUTF8 &operator=(ToUTF8 &&o) {
+        swap(*this, o);
+        return *this;
+    }
+
+    friend void swap(ToUTF8 &a, ToUTF8 &b) {
+        using std::swap;
+        swap(a.conv_, b.conv_);
+    }
+
+    std::string Convert(std::string_view str) {
+        std::string out;
+        Convert(str, &out, /*fatal=*/true);
+        return out;
+    }
+
+    // Like Convert, but returns false instead of exiting when str is not
+    // valid in the input encoding.
+    bool TryConvert(std::string_view str, std::string *out) {
+        out->clear();
+        return Convert(str, out, /*fatal=*/false);
+    }
+
+private:
+    // Appends the conversion of str to out. Returns false on invalid input,
+    // unless fatal, which exits instead.
+    bool Convert(std::string_view str, std::string *out, bool fatal) {
+        static constexpr size_t kBufferSize = BUFSIZ;
+
+        char *inbuf = const_cast<char*>(str.data());
+        size_t inbytesleft = str.length();
+        char outbuf[kBufferSize];
+        size_t outbytesleft = kBufferSize;
+        char *outptr = outbuf;
+
+        // Write out the byte sequence to get into the initial state (if
+        // necessary).
+        bool ok = Step(/*inbuf=*/nullptr, /*inbytesleft=*/nullptr, &outptr,
+                       &outbytesleft, fatal);
+        assert(ok);
+
+        do {
+            if (!Step(&inbuf, &inbytesleft, &outptr, &outbytesleft, fatal)) {
+                return false;
+            }
+            out->append(outbuf, kBufferSize - outbytesleft);
+            outptr = outbuf;
+            outbytesleft = kBufferSize;
+        } while(inbytesleft != 0);
+
+        // Flush partially converted input.
+        if (!Step(/*inbuf=*/nullptr, /*inbytesleft=*/nullptr, &outptr,
+                  &outbytesleft, fatal)) {
+            return false;
+        }
+        out->append(outbuf, kBufferSize - outbytesleft);
+        return true;
+    }
+
+    // One iconv call, converting as much as fits in outbuf.
+    bool Step(char **inbuf, size_t *inbytesleft, char **outbuf,
+              size_t *outbytesleft, bool fatal) {
+        size_t orig_ibl = 0;
+        if (inbytesleft) orig_ibl = *inbytesleft;
+        size_t ibl = orig_ibl;
+
+        size_t orig_obl = 0;
+        if (outbytesleft) orig_obl = *outbytesleft;
+        size_t obl = orig_obl;
+
+        assert(conv_ != kFailedIconvT);
+        size_t nconv = iconv(conv_, inbuf, &ibl, outbuf, &obl);
+        if (nconv == static_cast<size_t>(-1) && (errno != E2BIG || obl == orig_obl)) {
+            if (!fatal) return false;
+            std::perror("iconv");
+            std::exit(EXIT_FAILURE);
+        }
+
+        if (outbytesleft) *outbytesleft = obl;
+        if (inbytesleft) *inbytesleft = ibl;
+        return true;
+    }
+
+    iconv_t conv_ = kFailedIconvT;
+};
+
+}  // namespace nsfplay
+
+#endif
@@ -8,37 +8,62 @@ namespace xgm
   class Amplifier : virtual public IRenderable
   {
   protected:
-    IRenderable * target;
+    ISoundChip * target;
     int mute, volume;
+    bool masked; // every channel of the target is masked
 	int combo;
+    Profiler * profiler;
+    int profile_chip;
 
   public:
     Amplifier ()
     {
       target = NULL;
       mute = false;
+      masked = false;
       volume = 64;
+      profiler = NULL;
+      profile_chip = 0;
     }
 
     ~Amplifier ()
     {
     }
 
-    void Attach (IRenderable * p)
+    void Attach (ISoundChip * p)
     {
       target = p;
     }
 
+    // times the attached chip under Profiler::CHIP_TICK/CHIP_RENDER + chip
+    void SetProfiler (Profiler * p, int chip)
+    {
+      profiler = p;
+      profile_chip = chip;
+    }
+
+    // nothing the target renders will be heard
+    bool IsSilent () const
+    {
+      return mute || masked;
+    }
+
+    // a silent target only needs its state kept
     void Tick (UINT32 clocks)
     {
       assert (target);
-      target->Tick(clocks);
+      PROFILE_SCOPE (profiler, Profiler::CHIP_TICK + profile_chip, clocks);
+      if (IsSilent ())
+        target->TickState(clocks);
+      else
+        target->Tick(clocks);
     }
 
     UINT32 Render (INT32 b[2])
     {
       assert (target);
-      if (mute)
+      PROFILE_SCOPE (profiler, Profiler::CHIP_RENDER + profile_chip, 0);
+      if (IsSilent ())
       {
         b[0] = b[1] = 0;
         return 2;
@@ -66,6 +91,10 @@ namespace xgm
     {
       return mute;
     }
+    void SetMasked (bool m)
+    {
+      masked = m;
+    }
   };
 
 }                               // namespace
@@ -3,49 +3,134 @@
 
 using namespace xgm;
 
+EchoUnit::EchoUnit()
+{
+  rate = DEFAULT_RATE;
+  delay = 1000.0 / 16;
+  enable = false;
+  echo_buf = NULL;
+  size = 0;
+  eidx = 0;
+  edelay = 1;
+  for(int i=0; i<TAPS; i++) h[i] = 0;
+}
+
+EchoUnit::~EchoUnit()
+{
+  delete [] echo_buf;
+}
+
+// sizes the ring buffer from the delay and rate, keeping it if it fits
+void EchoUnit::Allocate()
+{
+  edelay = (int)(rate * delay / 1000.0);
+  if(edelay < 1) edelay = 1;
+  if(!enable) return;
+
+  UINT32 need = 1;
+  while(need < (UINT32)(TAPS * edelay)) need <<= 1;
+  if(echo_buf && need == size) return;
+
+  delete [] echo_buf;
+  size = need;
+  echo_buf = new INT32[size];
+  memset(echo_buf,0,sizeof(INT32)*size);
+  eidx = 0;
+}
+
 void EchoUnit::Reset()
 {
-  int hdef[16] = { 
+  int hdef[TAPS] = { 
       0,  0,  0,  0,
      64, 32, 16,  8,
      32, 16,  8,  4,
      16,  8,  4,  2,
   };
   eidx = 0;
-  memset(echo_buf,0,sizeof(INT32)*(1<<17));
-  for(int i=0; i<16; i++) h[i] = hdef[i];
+  if(echo_buf) memset(echo_buf,0,sizeof(INT32)*size);
+  for(int i=0; i<TAPS; i++) h[i] = hdef[i];
   lpf.SetParam(4700,100);
   lpf.Reset();
   hpf.SetParam(270,100);
   hpf.Reset();
 }
 
-void EchoUnit::SetRate(double rate)
+void EchoUnit::SetRate(double r)
 {
-  edelay = ((int)rate)/16;
+  rate = r;
+  Allocate();
   lpf.SetRate(rate);
   hpf.SetRate(rate);
 }
 
-inline xgm::UINT32 EchoUnit::FastRender(xgm::INT32 b[2])
+void EchoUnit::SetDelay(double ms)
 {
-  INT32 buf[2];
+  delay = ms;
+  Allocate();
+}
 
-  int tmp = eidx;
-  for(int i=0; i<16; i++) 
+void EchoUnit::SetEnable(bool e)
+{
+  enable = e;
+  if(enable)
   {
-    echo_buf[tmp&((1<<17)-1)] += (b[0]*h[i])>>8;
-    tmp += edelay;
+    Allocate();
   }
-  buf[0] = buf[1] = echo_buf[eidx];
-  lpf.FastRender(buf);
-  hpf.FastRender(buf);
-  echo_buf[eidx] = 0;
-  eidx = (eidx + 1)&((1<<17)-1);
+  else
+  {
+    delete [] echo_buf;
+    echo_buf = NULL;
+    size = 0;
+  }
+}
+
+void EchoUnit::RenderBlock(INT32 * b, UINT32 frames)
+{
+  if(!echo_buf) return;
+
+  INT32 e[BLOCK*2];
+  const UINT32 mask = size - 1;
+  const UINT32 chunk = ((UINT32)edelay < (UINT32)BLOCK) ? (UINT32)edelay : (UINT32)BLOCK;
+  UINT32 i, n;
+
+  for(UINT32 done=0; done<frames; done+=n, b+=n*2)
+  {
+    n = frames - done;
+    if(n > chunk) n = chunk;
 
-  b[0] += buf[0];
-  b[1] += buf[1];
+    // A chunk is no longer than one delay, so its reads only see writes
+    // from the zero-delay tap of the same frame, and the whole chunk can
+    // be scattered first.
+    for(int t=0; t<TAPS; t++)
+    {
+      if(h[t] == 0) continue;
+      UINT32 base = eidx + t * edelay;
+      for(i=0; i<n; i++)
+        echo_buf[(base+i)&mask] += (b[i*2]*h[t])>>8;
+    }
 
+    for(i=0; i<n; i++)
+    {
+      UINT32 j = (eidx+i)&mask;
+      e[i*2+0] = e[i*2+1] = echo_buf[j];
+      echo_buf[j] = 0;
+    }
+    eidx = (eidx + n)&mask;
+
+    lpf.RenderBlock(e, n);
+    hpf.RenderBlock(e, n);
+
+    for(i=0; i<n; i++)
+    {
+      b[i*2+0] += e[i*2+0];
+      b[i*2+1] += e[i*2+1];
+    }
+  }
+}
+
+inline xgm::UINT32 EchoUnit::FastRender(xgm::INT32 b[2])
+{
+  RenderBlock(b, 1);
   return 2;
 }
 
@@ -4,23 +4,38 @@
 
 namespace xgm {
 
+  // 16-tap echo over the left channel, filtered and added to both channels.
+  // The ring buffer holds 16 delays and is only allocated while enabled,
+  // so a disabled unit costs nothing per instance.
   class EchoUnit : public IRenderable {
+  public:
+    enum { TAPS = 16, BLOCK = 256 };
   protected:
-    int rate;
-    INT32 *echo_buf;
-    int h[32];
+    double rate;
+    double delay;     // ms between taps
+    bool enable;
+    INT32 *echo_buf;  // ring buffer of size entries, NULL while disabled
+    UINT32 size;      // power of 2, at least TAPS * edelay
+    int h[TAPS];
     int eidx, edelay;
     Filter lpf;
     DCFilter hpf;
 
+    void Allocate();
+
   public:
-    EchoUnit(){ echo_buf = new INT32[1<<17]; }
-    ~EchoUnit(){ delete [] echo_buf; }
+    EchoUnit();
+    ~EchoUnit();
     void Reset();
     void SetRate(double r);
+    void SetDelay(double ms);
+    void SetEnable(bool e);
+    bool IsEnabled() const { return enable; }
     virtual void Tick(UINT32 clocks);
     virtual UINT32 Render(INT32 b[2]);
     inline UINT32 FastRender(INT32 b[2]);
+    // adds the echo to a block of interleaved stereo frames
+    void RenderBlock(INT32 * b, UINT32 frames);
   };
 
 } // xgm
@@ -83,6 +83,13 @@ namespace xgm
     virtual UINT32 Render (INT32 b[2])
     {
       d->Render (b);
+      Apply (b);
+      return 2;
+    }
+
+    // fades a frame rendered without going through Render
+    void Apply (INT32 b[2])
+    {
       if (fade_pos > 0)
       {
         double fade_amount = double(fade_end - fade_pos + 1) / double(fade_end);
@@ -92,7 +99,6 @@ namespace xgm
         if (fade_pos < fade_end) ++fade_pos;
         else fade_pos = fade_end;
       }
-      return 2;
     }
   };
 
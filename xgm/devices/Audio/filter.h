@@ -149,6 +149,44 @@ namespace xgm
       return 2;
     }
 
+    // FastRender over a block of interleaved stereo frames
+    void RenderBlock(INT32 * b, UINT32 frames)
+    {
+      if(a>=1.0) return;
+      double o0 = out[0], o1 = out[1];
+      double i0 = in[0], i1 = in[1];
+      for (UINT32 i=0; i<frames; ++i, b+=2)
+      {
+        o0 = a * ( o0 + b[0] - i0 );
+        o1 = a * ( o1 + b[1] - i1 );
+        i0 = b[0];
+        i1 = b[1];
+        b[0] = (INT32)o0;
+        b[1] = (INT32)o1;
+      }
+      out[0] = o0; out[1] = o1;
+      in[0] = i0; in[1] = i1;
+    }
+
+    // same without truncating the output
+    void RenderBlockFloat(double * b, UINT32 frames)
+    {
+      if(a>=1.0) return;
+      double o0 = out[0], o1 = out[1];
+      double i0 = in[0], i1 = in[1];
+      for (UINT32 i=0; i<frames; ++i, b+=2)
+      {
+        o0 = a * ( o0 + b[0] - i0 );
+        o1 = a * ( o1 + b[1] - i1 );
+        i0 = b[0];
+        i1 = b[1];
+        b[0] = o0;
+        b[1] = o1;
+      }
+      out[0] = o0; out[1] = o1;
+      in[0] = i0; in[1] = i1;
+    }
+
     UINT32 Render (INT32 b[2])
     {
       return FastRender(b);
@@ -196,6 +234,7 @@ namespace xgm
 
     int type;
     INT32 out[2];
+    double fout[2]; // state of RenderBlockFloat
     double a;
     double rate, R, C;
     bool disable;
@@ -209,6 +248,7 @@ namespace xgm
       C = 10.0E-9;
       disable = false;
       out[0]=out[1]=0;
+      fout[0]=fout[1]=0.0;
     }
 
     virtual ~Filter ()
@@ -233,6 +273,37 @@ namespace xgm
       return 2;
     }
 
+    // FastRender over a block of interleaved stereo frames, filtering b
+    // directly (the target is not rendered)
+    void RenderBlock (INT32 * b, UINT32 frames)
+    {
+      if(a>=1.0) return;
+      INT32 o0 = out[0], o1 = out[1];
+      for (UINT32 i=0; i<frames; ++i, b+=2)
+      {
+        o0+=(INT32)(a*(b[0]-o0));
+        o1+=(INT32)(a*(b[1]-o1));
+        b[0]=o0;
+        b[1]=o1;
+      }
+      out[0] = o0; out[1] = o1;
+    }
+
+    // same without truncating, with its own state
+    void RenderBlockFloat (double * b, UINT32 frames)
+    {
+      if(a>=1.0) return;
+      double o0 = fout[0], o1 = fout[1];
+      for (UINT32 i=0; i<frames; ++i, b+=2)
+      {
+        o0+=a*(b[0]-o0);
+        o1+=a*(b[1]-o1);
+        b[0]=o0;
+        b[1]=o1;
+      }
+      fout[0] = o0; fout[1] = o1;
+    }
+
     virtual void Tick(UINT32 clocks)
     {
       if (target) target->Tick(clocks);
@@ -280,8 +351,110 @@ namespace xgm
     {
       UpdateFactor();
       out[0] = out[1] = 0;
+      fout[0] = fout[1] = 0.0;
+    }
+
+  };
+
+  // Output stage of the NES: first-order high-passes at 90Hz and 440Hz
+  // and a first-order low-pass at 14kHz, as a cascade of two biquads
+  // (the high-passes combined, then the low-pass).
+  // Replaces DCFilter and Filter when the hardware model is selected.
+  class NESOutputFilter
+  {
+  protected:
+    struct Biquad
+    {
+      double b0, b1, b2, a1, a2;
+      double s1[2], s2[2]; // transposed direct form II state per channel
+    };
+    Biquad q[2];
+    double rate;
+
+    // bilinear transform of a first-order section, (n0 + n1/z) / (1 + d1/z)
+    static void FirstOrder(double fc, double rate, bool highpass, double & n0, double & n1, double & d1)
+    {
+      const double PI = 3.14159265358979;
+      double k = tan(PI * fc / rate);
+      d1 = (k - 1.0) / (k + 1.0);
+      n0 = (highpass ? 1.0 : k) / (k + 1.0);
+      n1 = highpass ? -n0 : n0;
+    }
+
+    template <typename T>
+    void Run(T * b, UINT32 frames)
+    {
+      for (UINT32 i=0; i<frames; ++i, b+=2)
+      {
+        for (int c=0; c<2; ++c)
+        {
+          double x = b[c];
+          for (int j=0; j<2; ++j)
+          {
+            Biquad & f = q[j];
+            double y = f.b0 * x + f.s1[c];
+            f.s1[c] = f.b1 * x - f.a1 * y + f.s2[c];
+            f.s2[c] = f.b2 * x - f.a2 * y;
+            x = y;
+          }
+          b[c] = T(x);
+        }
+      }
+    }
+
+  public:
+    NESOutputFilter()
+    {
+      rate = DEFAULT_RATE;
+      UpdateFactor();
+      Reset();
+    }
+
+    void SetRate(double r)
+    {
+      rate = r;
+      UpdateFactor();
+    }
+
+    void UpdateFactor()
+    {
+      double h0, h1, hd, g0, g1, gd;
+      FirstOrder(90.0, rate, true, h0, h1, hd);
+      FirstOrder(440.0, rate, true, g0, g1, gd);
+      q[0].b0 = h0 * g0;
+      q[0].b1 = h0 * g1 + h1 * g0;
+      q[0].b2 = h1 * g1;
+      q[0].a1 = hd + gd;
+      q[0].a2 = hd * gd;
+
+      // past about 0.45 of the sample rate the low-pass has nothing to do
+      q[1].b0 = 1.0;
+      q[1].b1 = q[1].b2 = q[1].a1 = q[1].a2 = 0.0;
+      if (14000.0 < 0.45 * rate)
+        FirstOrder(14000.0, rate, false, q[1].b0, q[1].b1, q[1].a1);
+    }
+
+    void Reset()
+    {
+      for (int j=0; j<2; ++j)
+        for (int c=0; c<2; ++c)
+          q[j].s1[c] = q[j].s2[c] = 0.0;
+    }
+
+    // start as if the input had been held at b, with the output settled at 0
+    void SetLevel(INT32 b[2])
+    {
+      Reset();
+      for (int c=0; c<2; ++c)
+      {
+        q[0].s2[c] = q[0].b2 * b[c];
+        q[0].s1[c] = q[0].b1 * b[c] + q[0].s2[c];
+      }
     }
 
+    // interleaved stereo frames
+    void RenderBlock(INT32 * b, UINT32 frames) { Run(b, frames); }
+    void RenderBlockFloat(double * b, UINT32 frames) { Run(b, frames); }
   };
 
 }  // namespace
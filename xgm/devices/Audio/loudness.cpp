@@ -0,0 +1,163 @@
+#include <math.h>
+#include <string.h>
+#include "loudness.h"
+
+using namespace xgm;
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+LoudnessMeter::LoudnessMeter()
+{
+  enable = false;
+  SetRate(DEFAULT_RATE);
+}
+
+void LoudnessMeter::SetRate(double r)
+{
+  rate = r;
+
+  // K-weighting for any rate, from the 48kHz coefficients of BS.1770
+  double f0 = 1681.974450955533;
+  double G  = 3.999843853973347;
+  double Q  = 0.7071752369554196;
+  double K  = tan(M_PI * f0 / rate);
+  double Vh = pow(10.0, G / 20.0);
+  double Vb = pow(Vh, 0.4996667741545416);
+  double a0 = 1.0 + K / Q + K * K;
+  shelf_b[0] = (Vh + Vb * K / Q + K * K) / a0;
+  shelf_b[1] = 2.0 * (K * K - Vh) / a0;
+  shelf_b[2] = (Vh - Vb * K / Q + K * K) / a0;
+  shelf_a[0] = 1.0;
+  shelf_a[1] = 2.0 * (K * K - 1.0) / a0;
+  shelf_a[2] = (1.0 - K / Q + K * K) / a0;
+
+  f0 = 38.13547087602444;
+  Q  = 0.5003270373238773;
+  K  = tan(M_PI * f0 / rate);
+  a0 = 1.0 + K / Q + K * K;
+  hp_b[0] = 1.0;
+  hp_b[1] = -2.0;
+  hp_b[2] = 1.0;
+  hp_a[0] = 1.0;
+  hp_a[1] = 2.0 * (K * K - 1.0) / a0;
+  hp_a[2] = (1.0 - K / Q + K * K) / a0;
+
+  step = (UINT32)(rate / 10.0 + 0.5);
+  if (step < 1) step = 1;
+
+  // windowed sinc interpolator, one phase per oversampled position
+  oversample = (rate < 96000.0) ? 4 : (rate < 192000.0) ? 2 : 1;
+  int len = TP_TAPS * oversample;
+  fir.assign(len, 0.0);
+  for (int k = 0; k < len; k++)
+  {
+    double t = (k - (len - 1) / 2.0) / oversample;
+    double s = (t == 0.0) ? 1.0 : sin(M_PI * t) / (M_PI * t);
+    double w = 0.42 - 0.5 * cos(2.0 * M_PI * (k + 0.5) / len)
+                    + 0.08 * cos(4.0 * M_PI * (k + 0.5) / len);
+    fir[k] = s * w;
+  }
+  for (int p = 0; p < oversample; p++)
+  {
+    double sum = 0.0;
+    for (int j = 0; j < TP_TAPS; j++) sum += fir[p + j * oversample];
+    for (int j = 0; j < TP_TAPS; j++) fir[p + j * oversample] /= sum;
+  }
+
+  Reset();
+}
+
+void LoudnessMeter::Reset()
+{
+  memset(z, 0, sizeof(z));
+  memset(ring, 0, sizeof(ring));
+  memset(hist, 0, sizeof(hist));
+  step_pos = 0;
+  step_energy = 0.0;
+  ring_count = 0;
+  blocks.clear();
+  hpos = 0;
+  sample_peak = 0.0;
+  true_peak = 0.0;
+  frames = 0;
+}
+
+void LoudnessMeter::Process(const double * b, UINT32 length, int channels)
+{
+  if (!enable) return;
+  if (channels > 2) channels = 2;
+
+  for (UINT32 i = 0; i < length; i++, b += channels)
+  {
+    hpos = (hpos + 1) % TP_TAPS;
+    for (int c = 0; c < channels; c++)
+    {
+      double x = b[c];
+      double *s = z[c];
+
+      // two biquads in transposed direct form II
+      double y = shelf_b[0] * x + s[0];
+      s[0] = shelf_b[1] * x - shelf_a[1] * y + s[1];
+      s[1] = shelf_b[2] * x - shelf_a[2] * y;
+      double w = hp_b[0] * y + s[2];
+      s[2] = hp_b[1] * y - hp_a[1] * w + s[3];
+      s[3] = hp_b[2] * y - hp_a[2] * w;
+      step_energy += w * w;
+
+      double a = fabs(x);
+      if (a > sample_peak) sample_peak = a;
+      if (a > true_peak) true_peak = a;
+
+      // the oversampled positions, all between input samples
+      double *h = hist[c];
+      h[hpos] = h[hpos + TP_TAPS] = x;
+      const double *xn = &h[hpos + TP_TAPS];
+      for (int p = 0; p < oversample; p++)
+      {
+        const double *f = &fir[p];
+        double v = 0.0;
+        for (int j = 0; j < TP_TAPS; j++) v += f[j * oversample] * xn[-j];
+        v = fabs(v);
+        if (v > true_peak) true_peak = v;
+      }
+    }
+
+    if (++step_pos >= step)
+    {
+      // 400ms blocks overlapping by 75%
+      ring[ring_count & 3] = step_energy;
+      ring_count++;
+      if (ring_count >= 4)
+        blocks.push_back((ring[0] + ring[1] + ring[2] + ring[3]) / (4.0 * step));
+      step_pos = 0;
+      step_energy = 0.0;
+    }
+  }
+  frames += length;
+}
+
+double LoudnessMeter::GetIntegrated() const
+{
+  const double absolute = pow(10.0, (-70.0 + 0.691) / 10.0);
+
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    if (blocks[i] > absolute) { sum += blocks[i]; count++; }
+  }
+  if (count == 0) return -HUGE_VAL;
+
+  // relative gate, 10 LU below the absolute-gated loudness
+  double relative = sum / count * 0.1;
+  sum = 0.0;
+  count = 0;
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    if (blocks[i] > absolute && blocks[i] > relative) { sum += blocks[i]; count++; }
+  }
+  if (count == 0) return -HUGE_VAL;
+  return -0.691 + 10.0 * log10(sum / count);
+}
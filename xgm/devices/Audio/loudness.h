@@ -0,0 +1,55 @@
+#ifndef _LOUDNESS_H_
+#define _LOUDNESS_H_
+#include <vector>
+#include "../device.h"
+
+namespace xgm {
+
+  // ITU-R BS.1770-4 / EBU R128 meter over a whole track: K-weighted, gated
+  // integrated loudness, sample peak and true peak (4x oversampled below
+  // 96kHz). Fed with the final output, 1.0 = full scale, one block at a time.
+  class LoudnessMeter {
+  public:
+    enum { TP_TAPS = 12 }; // FIR taps per oversampling phase
+  protected:
+    double rate;
+    bool enable;
+
+    double shelf_b[3], shelf_a[3]; // K-weighting stage 1, high shelf
+    double hp_b[3], hp_a[3];       // stage 2, RLB highpass
+    double z[2][4];                // filter state per channel
+
+    UINT32 step;          // frames per 100ms gating step
+    UINT32 step_pos;
+    double step_energy;   // weighted sum of squares in the current step
+    double ring[4];       // the last four steps make a 400ms block
+    int ring_count;
+    std::vector<double> blocks; // mean square of every gating block
+
+    int oversample;
+    std::vector<double> fir;    // oversample phases of TP_TAPS taps
+    double hist[2][TP_TAPS*2];  // input history per channel, stored twice
+    int hpos;
+    double sample_peak, true_peak;
+    UINT64 frames;
+
+  public:
+    LoudnessMeter();
+    void Reset();
+    void SetRate(double r);
+    void SetEnable(bool e) { enable = e; }
+    bool IsEnabled() const { return enable; }
+    // interleaved frames of 1 or 2 channels
+    void Process(const double * b, UINT32 length, int channels);
+
+    // LUFS, -HUGE_VAL if no 400ms block got past the gates
+    double GetIntegrated() const;
+    // linear, 1.0 = full scale
+    double GetSamplePeak() const { return sample_peak; }
+    double GetTruePeak() const { return true_peak; }
+    double GetSeconds() const { return frames / rate; }
+  };
+
+} // xgm
+
+#endif
@@ -0,0 +1,84 @@
+#include <math.h>
+#include "overview.h"
+
+using namespace xgm;
+
+WaveformOverview::WaveformOverview()
+{
+  rate = DEFAULT_RATE;
+  bucket_ms = 0.0;
+  Reset();
+}
+
+void WaveformOverview::SetRate(double r)
+{
+  rate = r;
+  Reset();
+}
+
+void WaveformOverview::SetBucket(double ms)
+{
+  if (ms < 0.0) ms = 0.0;
+  if (ms != bucket_ms)
+  {
+    bucket_ms = ms;
+    Reset();
+  }
+}
+
+void WaveformOverview::Reset()
+{
+  channels = 1;
+  frames = 0;
+  count = 0;
+  next_edge = rate * bucket_ms / 1000.0;
+  for (int c = 0; c < 2; c++)
+  {
+    lo[c] = hi[c] = sq[c] = 0.0;
+  }
+  buckets.clear();
+}
+
+void WaveformOverview::Close()
+{
+  for (int c = 0; c < channels; c++)
+  {
+    Bucket bk;
+    bk.min = float(lo[c]);
+    bk.max = float(hi[c]);
+    bk.rms = float(sqrt(sq[c] / count));
+    buckets.push_back(bk);
+    lo[c] = hi[c] = sq[c] = 0.0;
+  }
+  count = 0;
+}
+
+void WaveformOverview::Process(const double * b, UINT32 length, int nch)
+{
+  if (!IsEnabled()) return;
+  if (nch > 2) nch = 2;
+  channels = nch;
+
+  for (UINT32 i = 0; i < length; i++, b += nch)
+  {
+    for (int c = 0; c < nch; c++)
+    {
+      double x = b[c];
+      if (count == 0 || x < lo[c]) lo[c] = x;
+      if (count == 0 || x > hi[c]) hi[c] = x;
+      sq[c] += x * x;
+    }
+    count++;
+    frames++;
+    if (frames >= next_edge)
+    {
+      Close();
+      next_edge = (double)(buckets.size() / channels + 1) * rate * bucket_ms / 1000.0;
+    }
+  }
+}
+
+void WaveformOverview::Finish()
+{
+  if (count > 0) Close();
+}
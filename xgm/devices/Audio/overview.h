@@ -0,0 +1,45 @@
+#ifndef _OVERVIEW_H_
+#define _OVERVIEW_H_
+#include <vector>
+#include "../device.h"
+
+namespace xgm {
+
+  // Waveform thumbnail of the rendered output: min, max and RMS over
+  // fixed-length buckets, per channel. Bucket edges follow the exact
+  // duration, so the buckets do not drift when ms * rate is fractional.
+  class WaveformOverview {
+  public:
+    struct Bucket { float min, max, rms; };
+  protected:
+    double rate;
+    double bucket_ms;    // 0 = disabled
+    int channels;
+    double next_edge;    // frame at which the current bucket ends
+    UINT64 frames;
+    UINT32 count;        // frames in the current bucket
+    double lo[2], hi[2], sq[2];
+    std::vector<Bucket> buckets; // interleaved by channel
+
+    void Close();
+
+  public:
+    WaveformOverview();
+    void Reset();
+    void SetRate(double r);
+    void SetBucket(double ms);
+    bool IsEnabled() const { return bucket_ms > 0.0; }
+    // interleaved frames of 1 or 2 channels, 1.0 = full scale
+    void Process(const double * b, UINT32 length, int channels);
+    // closes a partly filled last bucket
+    void Finish();
+
+    int GetChannels() const { return channels; }
+    double GetBucketMs() const { return bucket_ms; }
+    // GetChannels() entries per bucket
+    const std::vector<Bucket>& GetBuckets() const { return buckets; }
+  };
+
+} // xgm
+
+#endif
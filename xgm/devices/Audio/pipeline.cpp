@@ -0,0 +1,230 @@
+#include <string.h>
+#include "pipeline.h"
+
+using namespace xgm;
+
+ChipPipeline::Lane::Lane (Amplifier * a, ISoundChip * c, ISoundChip * s, CopyState cp)
+  : amp (a), chip (c), state (s), copy (cp), recording (NULL), sub (0)
+{
+  memset (tap, 0, sizeof (tap));
+}
+
+void ChipPipeline::Lane::Reset ()
+{
+  chip->Reset ();
+}
+
+bool ChipPipeline::Lane::Write (UINT32 adr, UINT32 val, UINT32 id)
+{
+  if (!recording)
+    return chip->Write (adr, val, id);
+
+  // writes the chip does not take leave it unchanged
+  if (!state->Write (adr, val, id))
+    return false;
+  Event e = { WRITE, adr, val };
+  recording->push_back (e);
+  return true;
+}
+
+bool ChipPipeline::Lane::Read (UINT32 adr, UINT32 & val, UINT32 id)
+{
+  if (!recording)
+    return chip->Read (adr, val, id);
+
+  // replayed too, reads can have side effects (N163 address increment)
+  if (!state->Read (adr, val, id))
+    return false;
+  Event e = { READ, adr, 0 };
+  recording->push_back (e);
+  return true;
+}
+
+void ChipPipeline::Lane::Tick (UINT32 clocks)
+{
+  if (!recording)
+  {
+    amp->Tick (clocks);
+    return;
+  }
+  Event e = { TICK, clocks, 0 };
+  recording->push_back (e);
+  if (copy) state->TickState (clocks);
+}
+
+UINT32 ChipPipeline::Lane::Render (INT32 b[2])
+{
+  if (!recording)
+    return amp->Render (b);
+
+  Event e = { RENDER, 0, 0 };
+  recording->push_back (e);
+  b[0] = b[1] = 0;
+  return 2;
+}
+
+void ChipPipeline::Lane::Replay (const RateConverter & rc, const std::vector<Event> & ev)
+{
+  const int mult = rc.GetMult ();
+  INT64 * o = &out[0];
+  INT32 t[2];
+  UINT32 v;
+
+  for (size_t i = 0; i < ev.size (); i++)
+  {
+    const Event & e = ev[i];
+    switch (e.type)
+    {
+    case WRITE:
+      chip->Write (e.adr, e.val);
+      break;
+    case READ:
+      chip->Read (e.adr, v);
+      break;
+    case TICK:
+      amp->Tick (e.adr);
+      break;
+    case RENDER:
+      // the same steps as RateConverter::RenderSum
+      if (sub == 0) rc.ShiftTaps (tap);
+      amp->Render (t);
+      ++sub;
+      tap[0][mult + sub] = t[0];
+      tap[1][mult + sub] = t[1];
+      if (sub == mult)
+      {
+        rc.Convolve (tap, o);
+        o += 2;
+        sub = 0;
+      }
+      break;
+    }
+  }
+}
+
+ChipPipeline::ChipPipeline ()
+  : rconv (NULL), set (0), sum (NULL), frames (0), generation (0), pending (0), quit (false)
+{
+}
+
+ChipPipeline::~ChipPipeline ()
+{
+  Wait ();
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    quit = true;
+  }
+  start.notify_all ();
+  for (size_t i = 0; i < workers.size (); i++)
+    workers[i].join ();
+  Clear ();
+}
+
+void ChipPipeline::Clear ()
+{
+  Wait ();
+  for (size_t i = 0; i < lanes.size (); i++)
+    delete lanes[i];
+  lanes.clear ();
+}
+
+ChipPipeline::Lane * ChipPipeline::Add (Amplifier * amp, ISoundChip * chip, ISoundChip * state, CopyState copy)
+{
+  Lane * l = new Lane (amp, chip, state, copy);
+  lanes.push_back (l);
+  return l;
+}
+
+void ChipPipeline::Reset ()
+{
+  Wait ();
+  for (size_t i = 0; i < lanes.size (); i++)
+  {
+    Lane * l = lanes[i];
+    l->recording = NULL;
+    l->sub = 0;
+    memset (l->tap, 0, sizeof (l->tap));
+  }
+}
+
+void ChipPipeline::Sync ()
+{
+  Wait ();
+  for (size_t i = 0; i < lanes.size (); i++)
+  {
+    Lane * l = lanes[i];
+    if (l->copy) l->copy (l->state, l->chip);
+  }
+}
+
+void ChipPipeline::Begin ()
+{
+  for (size_t i = 0; i < lanes.size (); i++)
+  {
+    Lane * l = lanes[i];
+    l->events[set].clear ();
+    l->recording = &l->events[set];
+  }
+}
+
+void ChipPipeline::Work (int index, UINT32 seen)
+{
+  for (;;)
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    start.wait (lock, [&] { return quit || generation != seen; });
+    if (quit) return;
+    seen = generation;
+    if (index >= int (lanes.size ())) continue;
+    Lane * l = lanes[index];
+    const std::vector<Lane::Event> & ev = l->events[set ^ 1];
+    lock.unlock ();
+
+    l->Replay (*rconv, ev);
+
+    lock.lock ();
+    if (--pending == 0) finish.notify_one ();
+  }
+}
+
+void ChipPipeline::Submit (INT64 * s, UINT32 n)
+{
+  assert (rconv);
+  Wait ();
+  if (lanes.empty ()) return;
+
+  for (size_t i = 0; i < lanes.size (); i++)
+  {
+    lanes[i]->recording = NULL;
+    lanes[i]->out.resize (n * 2);
+  }
+  while (workers.size () < lanes.size ())
+    workers.push_back (std::thread (&ChipPipeline::Work, this, int (workers.size ()), generation));
+
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    sum = s;
+    frames = n;
+    set ^= 1; // the workers replay what was just recorded
+    pending = int (lanes.size ());
+    ++generation;
+  }
+  start.notify_all ();
+}
+
+void ChipPipeline::Wait ()
+{
+  if (!sum) return;
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    finish.wait (lock, [&] { return pending == 0; });
+  }
+
+  for (size_t i = 0; i < lanes.size (); i++)
+  {
+    const INT64 * o = &lanes[i]->out[0];
+    for (UINT32 j = 0; j < frames * 2; j++)
+      sum[j] += o[j];
+  }
+  sum = NULL;
+}
@@ -0,0 +1,108 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../device.h"
+#include "amplifier.h"
+#include "rconv.h"
+
+namespace xgm
+{
+
+  // Renders expansion chips on worker threads, one block behind the CPU.
+  //
+  // Each chip is replaced on the bus and in the mixer by a Lane. While the
+  // CPU thread emulates a block, the Lane records the chip's writes, reads,
+  // ticks and renders in order, and answers the CPU from a state copy that
+  // only keeps what is readable (ISoundChip::TickState). Submit hands the
+  // block to the workers, which replay each Lane into its real chip through
+  // its own copy of the RateConverter filter, while the CPU thread goes on
+  // with the next block. Wait adds their sums to the rest of the mix.
+  // The result is the same as rendering serially.
+  //
+  // Outside Begin/Submit the Lanes pass everything straight to the chip, so
+  // Reset, the INIT call and Skip behave as before. Nothing may be in
+  // flight when the chips are configured.
+  class ChipPipeline
+  {
+  public:
+    typedef void (*CopyState)(ISoundChip * to, const ISoundChip * from);
+    template <class T>
+    static void Copy (ISoundChip * to, const ISoundChip * from)
+    {
+      *static_cast<T *>(to) = *static_cast<const T *>(from);
+    }
+
+    class Lane : public IDevice, public IRenderable
+    {
+      friend class ChipPipeline;
+    protected:
+      enum { WRITE, READ, TICK, RENDER };
+      struct Event { UINT32 type, adr, val; };
+
+      Amplifier * amp;
+      ISoundChip * chip;
+      ISoundChip * state;  // same type as chip, answers the CPU while recording
+      CopyState copy;      // NULL: nothing readable, state only decides Write
+      std::vector<Event> * recording; // NULL: pass through
+      std::vector<Event> events[2];   // the block being recorded and the one replayed
+      INT32 tap[2][128];
+      int sub;             // renders into the current output frame
+      std::vector<INT64> out;
+
+      void Replay (const RateConverter & rc, const std::vector<Event> & ev);
+
+    public:
+      Lane (Amplifier * a, ISoundChip * c, ISoundChip * s, CopyState cp);
+
+      virtual void Reset ();
+      virtual bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
+      virtual bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
+      virtual void Tick (UINT32 clocks);
+      virtual UINT32 Render (INT32 b[2]);
+    };
+
+  protected:
+    RateConverter * rconv;
+    std::vector<Lane *> lanes;
+    int set;             // events[set] records, the other one replays
+    INT64 * sum;         // the block in flight, NULL if none
+    UINT32 frames;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start, finish;
+    UINT32 generation;
+    int pending;
+    bool quit;
+
+    void Work (int index, UINT32 seen);
+
+  public:
+    ChipPipeline ();
+    ~ChipPipeline ();
+
+    void SetConverter (RateConverter * r) { rconv = r; }
+    void Clear ();
+    // Attach the result to the bus and the mixer in place of the chip and amp
+    Lane * Add (Amplifier * amp, ISoundChip * chip, ISoundChip * state, CopyState copy);
+    bool IsActive () const { return !lanes.empty (); }
+
+    // with RateConverter::Reset
+    void Reset ();
+    // state copies from the chips, before a run of blocks
+    void Sync ();
+    // before a block is emulated
+    void Begin ();
+    // starts rendering the recorded block, whose RateConverter::RenderSum
+    // frames are in sum; the lanes are added to it by the next Wait
+    void Submit (INT64 * sum, UINT32 frames);
+    // waits for the block in flight, if any
+    void Wait ();
+  };
+
+} // namespace xgm
+
+#endif
@@ -22,7 +22,7 @@ static double window(int n, int M)
 }
 
 RateConverter::RateConverter () : clock(0.0), rate(0.0), mult(0), clocks(0),
-	cpu(NULL), dmc(NULL), mmc5(NULL), cpu_clocks(0), cpu_rest(0),
+	cpu(NULL), dmc(NULL), mmc5(NULL), profiler(NULL), cpu_clocks(0), cpu_rest(0),
 	fast_skip(true)
 {
 }
@@ -103,6 +103,7 @@ void RateConverter::ClockCPU(int c)
 		cpu_rest += c;
 		if (cpu_rest > 0)
 		{
+			PROFILE_SCOPE(profiler, Profiler::CPU_EXEC, cpu_rest);
 			real_cpu_clocks = cpu->Exec(cpu_rest);
 			cpu_rest -= real_cpu_clocks;
 		}
@@ -113,6 +114,7 @@ void RateConverter::ClockCPU(int c)
 
 void RateConverter::Skip ()
 {
+	PROFILE_SCOPE(profiler, Profiler::RATE_CONVERTER, clocks);
 	if (fast_skip) // behaves like quality=1, fine except for rare cases that need sub-sample synchronization
 	{
 		ClockCPU(cpu_clocks);
@@ -157,17 +159,51 @@ void RateConverter::Skip ()
 // ͂-32768`+32767܂
 inline UINT32 RateConverter::FastRender (INT32 b[2])
 {
-  assert (target);
-
-  //double out[2];
   INT64 out[2];
-  static INT32 t[2];
+  RenderSum(out);
+  Scale(out, b);
+  return 2;
+}
 
+void RateConverter::ShiftTaps (INT32 t[2][128]) const
+{
   for(int i=0; i<=mult; i++)
   {
-    tap[0][i] = tap[0][i+mult];
-    tap[1][i] = tap[1][i+mult];
+    t[0][i] = t[0][i+mult];
+    t[1][i] = t[1][i+mult];
+  }
+}
+
+void RateConverter::Convolve (const INT32 t[2][128], INT64 out[2]) const
+{
+  //out[0] = hr[0] * tap[0][mult];
+  //out[1] = hr[0] * tap[1][mult];
+  out[0] = hri[0] * t[0][mult];
+  out[1] = hri[0] * t[1][mult];
+
+  for(int i=1; i<=mult; i++)
+  {
+    //out[0] += hr[i] * (tap[0][mult+i]+tap[0][mult-i]);
+    //out[1] += hr[i] * (tap[1][mult+i]+tap[1][mult-i]);
+    out[0] += hri[i] * (t[0][mult+i]+t[0][mult-i]);
+    out[1] += hri[i] * (t[1][mult+i]+t[1][mult-i]);
   }
+}
+
+void RateConverter::Scale (const INT64 sum[2], INT32 b[2])
+{
+  b[0] = INT32(sum[0] >> PRECISION);
+  b[1] = INT32(sum[1] >> PRECISION);
+}
+
+void RateConverter::RenderSum (INT64 out[2])
+{
+  assert (target);
+  PROFILE_SCOPE(profiler, Profiler::RATE_CONVERTER, clocks);
+
+  INT32 t[2];
+
+  ShiftTaps(tap);
 
   // divide clock ticks among samples evenly
   int mclocks = 0;
@@ -201,25 +237,7 @@ inline UINT32 RateConverter::FastRender (INT32 b[2])
   clocks = 0;
   cpu_clocks = 0;
 
-  //out[0] = hr[0] * tap[0][mult];
-  //out[1] = hr[0] * tap[1][mult];
-  out[0] = hri[0] * tap[0][mult];
-  out[1] = hri[0] * tap[1][mult];
-
-  for(int i=1; i<=mult; i++)
-  {
-    //out[0] += hr[i] * (tap[0][mult+i]+tap[0][mult-i]);
-    //out[1] += hr[i] * (tap[1][mult+i]+tap[1][mult-i]);
-    out[0] += hri[i] * (tap[0][mult+i]+tap[0][mult-i]);
-    out[1] += hri[i] * (tap[1][mult+i]+tap[1][mult-i]);
-  }
-
-  //b[0] = (INT32)out[0];
-  //b[1] = (INT32)out[1];
-  b[0] = INT32(out[0] >> PRECISION);
-  b[1] = INT32(out[1] >> PRECISION);
-
-  return 2;
+  Convolve(tap, out);
 }
 
 }//namespace xgm
\ No newline at end of file
@@ -29,6 +29,7 @@ protected:
 	NES_CPU* cpu;
 	NES_DMC* dmc;
 	NES_MMC5* mmc5;
+	Profiler* profiler;
 	int cpu_clocks; // CPU clocks pending Tick
 	int cpu_rest; // extra clock accumulator (instructions will get ahead by a few clocks)
 	bool fast_skip;
@@ -47,6 +48,15 @@ public:
 	virtual void Skip(); // Does ticks in lieu of Render
 	inline UINT32 FastRender(INT32 b[2]);
 
+	// Render without the final scaling, so sums from devices rendered
+	// elsewhere (ChipPipeline) can be added before Scale.
+	void RenderSum (INT64 out[2]);
+	static void Scale (const INT64 sum[2], INT32 b[2]);
+	// the filter for such devices, which keep their own taps
+	int GetMult () const { return mult; }
+	void ShiftTaps (INT32 t[2][128]) const;
+	void Convolve (const INT32 t[2][128], INT64 out[2]) const;
+
 	// call TickCPU before each Tick
 	void TickCPU(int t) { cpu_clocks+=t; }
 
@@ -54,6 +64,7 @@ public:
 	void SetDMC(NES_DMC* d) { dmc=d; }
 	void SetMMC5(NES_MMC5* m) { mmc5=m; }
 	void SetFastSkip(bool s) { fast_skip=s; }
+	void SetProfiler(Profiler* p) { profiler=p; }
 };
 
 } // namespace
@@ -3,6 +3,7 @@
 #include "nes_cpu.h"
 #include "../Memory/nes_mem.h"
 #include "../Misc/nsf2_irq.h"
+#include "../Misc/profile_cpu.h"
 
 #define DEBUG_RW 0
 #define TRACE 0
@@ -74,6 +75,7 @@ NES_CPU::NES_CPU (double clock)
   bus = NULL;
   nes_mem = NULL;
   log_cpu = NULL;
+  prof_cpu = NULL;
   irqs = 0;
   enable_irq = true;
   enable_nmi = false;
@@ -105,6 +107,7 @@ void NES_CPU::run_from (UINT32 address)
 	breaked = false;
 	context.PC = PLAYER_RESERVED; // JSR, followed by infinite loop ("breaked")
 	breakpoint = context.PC+3;
+	if (prof_cpu) prof_cpu->Restart();
 	assert (nes_mem);
 	nes_mem->WriteReserved (PLAYER_RESERVED+1, address & 0xff);
 	nes_mem->WriteReserved (PLAYER_RESERVED+2, address>>8);
@@ -141,6 +144,19 @@ int NES_CPU::Exec (int clocks)
 		if (!breaked)
 		{
 			//DEBUG_OUT("PC: 0x%04X\n", context.PC);
+			#if NSFPLAY_PROFILE
+			if (prof_cpu)
+			{
+				UINT32 pc = context.PC;
+				UINT32 sp = context.S;
+				int irq = CPUProfiler::INT_NONE;
+				if (context.iRequest & IRQ_NMI) irq = CPUProfiler::INT_NMI;
+				else if ((context.iRequest & IRQ_INT) && !(context.P & K6502_I_FLAG)) irq = CPUProfiler::INT_IRQ;
+				exec(context,bus);
+				prof_cpu->Step(pc, sp, irq, context.lastcode, context.PC, context.S, context.clock - clock_start);
+			}
+			else
+			#endif
 			exec(context,bus);
 			if (context.PC == breakpoint)
 			{
@@ -376,6 +392,11 @@ void NES_CPU::SetLogger (CPULogger* logger)
 	log_cpu = logger;
 }
 
+void NES_CPU::SetProfiler (CPUProfiler* profiler)
+{
+	prof_cpu = profiler;
+}
+
 unsigned int NES_CPU::GetPC() const
 {
 	return context.PC;
@@ -18,6 +18,7 @@ namespace xgm
 
 class NES_MEM; // forward declaration
 class NSF2_IRQ; // forward declaration
+class CPUProfiler; // forward declaration
 
 class NES_CPU : public IDevice
 {
@@ -43,6 +44,7 @@ protected:
   UINT8 nsf2_bits;
   NSF2_IRQ* nsf2_irq;
   CPULogger *log_cpu;
+  CPUProfiler *prof_cpu;
 
   void run_from (UINT32 address);
 
@@ -66,6 +68,7 @@ public:
   bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
   bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
   void SetLogger (CPULogger *logger);
+  void SetProfiler (CPUProfiler *profiler); // only used by NSFPLAY_PROFILE builds
   unsigned int GetPC() const;
   void StealCycles(unsigned int cycles);
   void EnableNMI(bool enable);
@@ -149,6 +149,15 @@ namespace xgm
     return false;
   }
 
+  int NES_BANK::GetBank (UINT32 adr) const
+  {
+    if (0x8000 <= adr && adr < 0x10000)
+      return bankswitch[adr >> 12];
+    if (fds_enable && 0x6000 <= adr && adr < 0x8000)
+      return bankswitch[adr >> 12];
+    return -1;
+  }
+
   bool NES_BANK::Read (UINT32 adr, UINT32 & val, UINT32 id)
   {
     if (0x5ff8 <= adr && adr < 0x5fff)
@@ -27,6 +27,7 @@ namespace xgm
     void SetBankDefault (UINT8 bank, int value);
     bool SetImage (UINT8 * data, UINT32 offset, UINT32 size);
     void SetFDSMode (bool); // enables banks 6/7 for FDS
+    int GetBank (UINT32 adr) const; // bank mapped at adr, -1 if not banked
   };
 
 }
@@ -2,7 +2,7 @@
 
 namespace xgm
 {
-  static UINT8 maskAPU[16] = 
+  static const UINT8 maskAPU[16] = 
   { 
 #if 1
     0xff, 0xff, 0xff, 0xff,
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <string>
+#include "profile_cpu.h"
+#include "../Memory/nes_bank.h"
+
+namespace xgm
+{
+
+CPUProfiler::CPUProfiler()
+{
+    bank = NULL;
+    pc_cycles = NULL;
+    Clear();
+}
+
+CPUProfiler::~CPUProfiler()
+{
+    delete [] pc_cycles;
+}
+
+void CPUProfiler::SetEnable(bool e)
+{
+    if (e && pc_cycles == NULL)
+    {
+        pc_cycles = new UINT64[PC_TABLE_SIZE];
+        Clear();
+    }
+    else if (!e && pc_cycles != NULL)
+    {
+        delete [] pc_cycles;
+        pc_cycles = NULL;
+    }
+}
+
+void CPUProfiler::SetBank(const NES_BANK* b)
+{
+    bank = b;
+}
+
+void CPUProfiler::Clear()
+{
+    if (pc_cycles)
+        std::fill(pc_cycles, pc_cycles + PC_TABLE_SIZE, UINT64(0));
+    std::fill(bank_slot, bank_slot + 256, UINT8(8));
+    total_cycles = 0;
+
+    node.clear();
+    child.clear();
+    Node root = { -1, KEY_ROOT, 0, 0 };
+    node.push_back(root);
+    Restart();
+}
+
+void CPUProfiler::Restart()
+{
+    depth = 0;
+}
+
+UINT32 CPUProfiler::Key(UINT32 adr) const
+{
+    adr &= 0xFFFF;
+    int b = bank ? bank->GetBank(adr) : -1;
+    if (b < 0) return adr;
+    return (UINT32(b + 1) << 16) | adr;
+}
+
+void CPUProfiler::Push(UINT32 key, UINT32 sp)
+{
+    if (depth >= int(STACK_MAX)) return; // runaway recursion or stack tricks, keep the current frame
+
+    int parent = depth ? stack[depth-1].node : 0;
+    UINT64 ck = (UINT64(parent) << 32) | key;
+    std::map<UINT64, int>::iterator it = child.find(ck);
+    int n;
+    if (it == child.end())
+    {
+        n = int(node.size());
+        Node nn = { parent, key, 0, 0 };
+        node.push_back(nn);
+        child[ck] = n;
+    }
+    else n = it->second;
+
+    node[n].calls++;
+    stack[depth].node = n;
+    stack[depth].sp = sp;
+    ++depth;
+}
+
+void CPUProfiler::Step(UINT32 pc, UINT32 sp, int irq, UINT32 opcode, UINT32 new_pc, UINT32 new_sp, UINT32 cycles)
+{
+    if (pc_cycles == NULL) return;
+
+    if (irq != INT_NONE)
+    {
+        Push(irq == INT_NMI ? KEY_NMI : KEY_IRQ, sp);
+        sp = (sp - 3) & 0xFF; // PC and P pushed
+    }
+
+    UINT32 k = Key(pc);
+    UINT32 index = k;
+    if (k >= PC_UNBANKED)
+    {
+        UINT32 b = (k >> 16) - 1;
+        index = PC_UNBANKED + (b << 12) + (k & 0x0FFF);
+        bank_slot[b] = UINT8((k >> 12) & 0xF);
+    }
+    pc_cycles[index] += cycles;
+    node[depth ? stack[depth-1].node : 0].cycles += cycles;
+    total_cycles += cycles;
+
+    if (opcode == 0x20) // JSR
+    {
+        Push(Key(new_pc), sp);
+    }
+    else if (opcode == 0x60 || opcode == 0x40) // RTS, RTI
+    {
+        // pop every frame whose return address has been pulled,
+        // which also unwinds routines that discard their return address
+        while (depth > 0 && stack[depth-1].sp <= (new_sp & 0xFF))
+            --depth;
+    }
+}
+
+void CPUProfiler::KeyName(UINT32 key, char* buf) const
+{
+    if      (key == KEY_ROOT) ::sprintf(buf, "nsf");
+    else if (key == KEY_NMI)  ::sprintf(buf, "NMI");
+    else if (key == KEY_IRQ)  ::sprintf(buf, "IRQ");
+    else if (key >= 0x10000)  ::sprintf(buf, "%02X:%04X", (key >> 16) - 1, key & 0xFFFF);
+    else                      ::sprintf(buf, "$%04X", key);
+}
+
+void CPUProfiler::Report(FILE* f, int lines) const
+{
+    if (!Profiler::Enabled())
+    {
+        ::fprintf(f, "CPU profile: not available (build with NSFPLAY_PROFILE=1)\n");
+        return;
+    }
+    if (pc_cycles == NULL)
+    {
+        ::fprintf(f, "CPU profile: not enabled\n");
+        return;
+    }
+
+    char name[16];
+    double total = total_cycles ? double(total_cycles) : 1.0;
+    ::fprintf(f, "CPU profile: %llu cycles\n", total_cycles);
+
+    // hottest instructions
+    std::vector< std::pair<UINT64, UINT32> > pcs;
+    for (UINT32 i=0; i<PC_TABLE_SIZE; ++i)
+    {
+        if (pc_cycles[i] == 0) continue;
+        UINT32 b = (i - PC_UNBANKED) >> 12;
+        UINT32 k = (i < PC_UNBANKED) ? i :
+            ((b + 1) << 16) | (UINT32(bank_slot[b]) << 12) | (i & 0x0FFF);
+        pcs.push_back(std::make_pair(pc_cycles[i], k));
+    }
+    std::sort(pcs.rbegin(), pcs.rend());
+    ::fprintf(f, "%-10s %14s %7s\n", "PC", "cycles", "%");
+    for (int i=0; i<int(pcs.size()) && i<lines; ++i)
+    {
+        KeyName(pcs[i].second, name);
+        ::fprintf(f, "%-10s %14llu %6.2f%%\n", name, pcs[i].first, 100.0 * double(pcs[i].first) / total);
+    }
+
+    // subtree totals, children always come after their parent
+    std::vector<UINT64> incl(node.size());
+    for (size_t i=0; i<node.size(); ++i) incl[i] = node[i].cycles;
+    for (size_t i=node.size(); i-- > 1;) incl[node[i].parent] += incl[i];
+
+    // JSR targets, inclusive time counted once per outermost activation
+    std::map<UINT32, UINT64> t_incl, t_self, t_calls;
+    for (size_t i=1; i<node.size(); ++i)
+    {
+        UINT32 k = node[i].key;
+        t_self[k] += node[i].cycles;
+        t_calls[k] += node[i].calls;
+        bool nested = false;
+        for (int p = node[i].parent; p > 0; p = node[p].parent)
+            if (node[p].key == k) { nested = true; break; }
+        if (!nested) t_incl[k] += incl[i];
+    }
+    std::vector< std::pair<UINT64, UINT32> > targets;
+    for (std::map<UINT32, UINT64>::const_iterator it = t_incl.begin(); it != t_incl.end(); ++it)
+        targets.push_back(std::make_pair(it->second, it->first));
+    std::sort(targets.rbegin(), targets.rend());
+    ::fprintf(f, "%-10s %10s %14s %7s %14s %7s\n", "routine", "calls", "total", "%", "self", "%");
+    for (int i=0; i<int(targets.size()) && i<lines; ++i)
+    {
+        UINT32 k = targets[i].second;
+        UINT64 self = t_self[k];
+        KeyName(k, name);
+        ::fprintf(f, "%-10s %10llu %14llu %6.2f%% %14llu %6.2f%%\n",
+            name, t_calls[k], targets[i].first, 100.0 * double(targets[i].first) / total,
+            self, 100.0 * double(self) / total);
+    }
+}
+
+void CPUProfiler::WriteCollapsed(FILE* f) const
+{
+    char name[16];
+    for (size_t i=0; i<node.size(); ++i)
+    {
+        if (node[i].cycles == 0) continue;
+        std::string path;
+        for (int n = int(i); n >= 0; n = node[n].parent)
+        {
+            KeyName(node[n].key, name);
+            path = (path.empty()) ? std::string(name) : (std::string(name) + ";" + path);
+        }
+        ::fprintf(f, "%s %llu\n", path.c_str(), node[i].cycles);
+    }
+}
+
+} // namespace xgm
@@ -0,0 +1,94 @@
+#ifndef _PROFILE_CPU_H_
+#define _PROFILE_CPU_H_
+
+#include "../device.h"
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace xgm
+{
+
+class NES_BANK; // forward
+
+// CPUProfiler
+//
+// 6502 hot-spot profiler. NES_CPU reports each executed instruction
+// (only in NSFPLAY_PROFILE builds) and the cycles are accumulated per
+// (bank, PC) and per call stack, where the stack is followed through
+// JSR/RTS and NMI/IRQ/RTI using the stack pointer.
+//
+// Addresses mapped through NES_BANK are keyed by their 4k bank,
+// printed as BB:AAAA, other addresses print as $AAAA.
+
+class CPUProfiler
+{
+public:
+    CPUProfiler();
+    ~CPUProfiler();
+
+    // allocates the PC table (about 9MB) on first enable
+    void SetEnable(bool e);
+    bool IsEnabled() const { return pc_cycles != NULL; }
+    void SetBank(const NES_BANK* b);
+
+    void Clear(); // zeroes all counts
+    void Restart(); // empties the call stack, called when the player starts a routine
+
+    enum { INT_NONE = 0, INT_NMI, INT_IRQ };
+
+    // pc/sp before the instruction, opcode/new_pc/new_sp after,
+    // irq is INT_NMI/INT_IRQ if an interrupt was taken before the instruction
+    void Step(UINT32 pc, UINT32 sp, int irq, UINT32 opcode, UINT32 new_pc, UINT32 new_sp, UINT32 cycles);
+
+    // sorted text report of the hottest PCs and JSR targets
+    void Report(FILE* f, int lines=40) const;
+
+    // one "frame;frame;frame cycles" line per call stack,
+    // input format for flamegraph.pl / speedscope
+    void WriteCollapsed(FILE* f) const;
+
+    UINT64 GetTotalCycles() const { return total_cycles; }
+
+protected:
+    enum
+    {
+        PC_UNBANKED = 0x10000,
+        PC_TABLE_SIZE = PC_UNBANKED + (256 * 0x1000),
+        STACK_MAX = 64,
+        KEY_ROOT = 0xFFFFFFFF,
+        KEY_NMI = 0x02000000,
+        KEY_IRQ = 0x02000001
+    };
+
+    struct Node
+    {
+        int parent;
+        UINT32 key;
+        UINT64 cycles; // self cycles
+        UINT64 calls;
+    };
+
+    struct Frame
+    {
+        int node;
+        UINT32 sp; // stack pointer before the call
+    };
+
+    const NES_BANK* bank;
+    UINT64* pc_cycles;
+    UINT8 bank_slot[256]; // last 4k slot each bank was seen in, for printing
+    UINT64 total_cycles;
+    std::vector<Node> node;
+    std::map<UINT64, int> child; // (parent << 32 | key) -> node
+    Frame stack[STACK_MAX];
+    int depth;
+
+    UINT32 Key(UINT32 adr) const;
+    void Push(UINT32 key, UINT32 sp);
+    void KeyName(UINT32 key, char* buf) const;
+};
+
+} // namespace xgm
+
+#endif
@@ -0,0 +1,118 @@
+#include "profiler.h"
+
+namespace xgm
+{
+
+Profiler::Profiler()
+{
+  for (int i=0; i<SLOT_MAX; ++i)
+  {
+    slot[i].name = NULL;
+    slot[i].parent = -1;
+  }
+  bus_count = 0;
+  Clear();
+}
+
+void Profiler::Clear()
+{
+  for (int i=0; i<SLOT_MAX; ++i)
+  {
+    slot[i].calls = 0;
+    slot[i].clocks = 0;
+    slot[i].ns = 0;
+  }
+  for (int i=0; i<bus_count; ++i)
+  {
+    bus[i].reads = 0;
+    bus[i].writes = 0;
+  }
+  bus_reads = 0;
+  bus_writes = 0;
+  samples = 0;
+}
+
+void Profiler::SetSlotName(int id, const char* name, int parent)
+{
+  if (id < 0 || id >= SLOT_MAX) return;
+  slot[id].name = name;
+  slot[id].parent = parent;
+}
+
+void Profiler::SetBusName(const IDevice* d, const char* name)
+{
+  BusDevice* b = FindBus(d);
+  if (b) b->name = name;
+}
+
+void Profiler::ClearBusNames()
+{
+  bus_count = 0;
+}
+
+Profiler::BusDevice* Profiler::FindBus(const IDevice* d)
+{
+  for (int i=0; i<bus_count; ++i)
+    if (bus[i].device == d) return &bus[i];
+  if (bus_count >= BUS_MAX) return NULL;
+
+  // first access from an unnamed device
+  BusDevice* b = &bus[bus_count++];
+  b->device = d;
+  b->name = "(unnamed)";
+  b->reads = 0;
+  b->writes = 0;
+  return b;
+}
+
+UINT64 Profiler::GetSelfTime(int id) const
+{
+  UINT64 t = slot[id].ns;
+  for (int i=0; i<SLOT_MAX; ++i)
+  {
+    if (slot[i].parent != id) continue;
+    t = (slot[i].ns > t) ? 0 : (t - slot[i].ns);
+  }
+  return t;
+}
+
+void Profiler::Report(FILE* f) const
+{
+  if (!Enabled())
+  {
+    fprintf(f, "profile: not available (build with NSFPLAY_PROFILE=1)\n");
+    return;
+  }
+
+  UINT64 total = 0;
+  for (int i=0; i<SLOT_MAX; ++i)
+    if (slot[i].parent < 0) total += slot[i].ns;
+
+  fprintf(f, "profile: %llu samples, %.3f ms\n", samples, double(total) / 1000000.0);
+  fprintf(f, "%-16s %12s %14s %12s %12s %6s\n", "stage", "calls", "clocks", "total ms", "self ms", "self%");
+  for (int i=0; i<SLOT_MAX; ++i)
+  {
+    const Slot& s = slot[i];
+    if (s.name == NULL || s.calls == 0) continue;
+    UINT64 self = GetSelfTime(i);
+    fprintf(f, "%-16s %12llu %14llu %12.3f %12.3f %5.1f%%\n",
+      s.name, s.calls, s.clocks,
+      double(s.ns) / 1000000.0, double(self) / 1000000.0,
+      total ? (100.0 * double(self) / double(total)) : 0.0);
+  }
+
+  fprintf(f, "%-16s %12s %12s\n", "bus device", "reads", "writes");
+  UINT64 claimed_reads = 0, claimed_writes = 0;
+  for (int i=0; i<bus_count; ++i)
+  {
+    const BusDevice& b = bus[i];
+    if (b.reads == 0 && b.writes == 0) continue;
+    fprintf(f, "%-16s %12llu %12llu\n", b.name, b.reads, b.writes);
+    claimed_reads += b.reads;
+    claimed_writes += b.writes;
+  }
+  fprintf(f, "%-16s %12llu %12llu\n", "(unclaimed)",
+    bus_reads - claimed_reads, bus_writes - claimed_writes);
+}
+
+} // namespace xgm
@@ -0,0 +1,155 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+// Render profiler
+//
+// Accumulates wall time, call counts and emulated clocks for the stages of
+// NSFPlayer::Render/Skip, and counts which device in the CPU's memory stack
+// claimed each read/write.
+//
+// The hooks are only compiled in with NSFPLAY_PROFILE=1
+// (e.g. make CXXFLAGS_EXTRA=-DNSFPLAY_PROFILE=1). Otherwise the PROFILE_*
+// macros expand to nothing and the counters simply stay at zero.
+
+#ifndef NSFPLAY_PROFILE
+#define NSFPLAY_PROFILE 0
+#endif
+
+#include <stdio.h>
+#include <chrono>
+#include "../../xtypes.h"
+
+namespace xgm
+{
+
+class IDevice; // forward
+
+class Profiler
+{
+public:
+  enum
+  {
+    CPU_EXEC = 0,
+    RATE_CONVERTER,
+    DC_FILTER,
+    LOW_PASS_FILTER,
+    LOOP_DETECT,
+    CHIP_TICK,                          // + sound chip index
+    CHIP_RENDER = CHIP_TICK + 8,        // + sound chip index
+    SLOT_MAX    = CHIP_RENDER + 8
+  };
+  enum { BUS_MAX = 16 };
+
+  struct Slot
+  {
+    const char* name;
+    int parent;    // slot whose time includes this one, -1 for none
+    UINT64 calls;
+    UINT64 clocks; // emulated clocks requested (Tick/Exec)
+    UINT64 ns;     // inclusive wall time
+  };
+
+  struct BusDevice
+  {
+    const IDevice* device;
+    const char* name;
+    UINT64 reads;  // reads claimed by this device
+    UINT64 writes; // writes claimed by this device
+  };
+
+protected:
+  Slot slot[SLOT_MAX];
+  BusDevice bus[BUS_MAX];
+  int bus_count;
+  UINT64 bus_reads, bus_writes; // all accesses, including unclaimed
+  UINT64 samples;
+
+  BusDevice* FindBus(const IDevice* d);
+
+public:
+  Profiler();
+
+  // true if the hooks were compiled in
+  static bool Enabled() { return NSFPLAY_PROFILE != 0; }
+
+  // zeroes all counters, keeps names
+  void Clear();
+
+  void SetSlotName(int id, const char* name, int parent=-1);
+  void SetBusName(const IDevice* d, const char* name);
+  void ClearBusNames();
+
+  static UINT64 Now()
+  {
+    return UINT64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  void Add(int id, UINT64 ns, UINT64 clocks)
+  {
+    slot[id].calls++;
+    slot[id].clocks += clocks;
+    slot[id].ns += ns;
+  }
+
+  void AddSamples(UINT64 n) { samples += n; }
+
+  void BusRead(const IDevice* d)
+  {
+    ++bus_reads;
+    if (d) { BusDevice* b = FindBus(d); if (b) ++b->reads; }
+  }
+
+  void BusWrite(const IDevice* d)
+  {
+    ++bus_writes;
+    if (d) { BusDevice* b = FindBus(d); if (b) ++b->writes; }
+  }
+
+  const Slot& GetSlot(int id) const { return slot[id]; }
+  UINT64 GetSelfTime(int id) const; // inclusive time minus child slots
+  int GetBusCount() const { return bus_count; }
+  const BusDevice& GetBus(int i) const { return bus[i]; }
+  UINT64 GetBusReads() const { return bus_reads; }
+  UINT64 GetBusWrites() const { return bus_writes; }
+  UINT64 GetSamples() const { return samples; }
+
+  // human readable table
+  void Report(FILE* f) const;
+};
+
+// times the enclosing block into a Profiler slot
+class ProfileScope
+{
+protected:
+  Profiler* profiler;
+  int id;
+  UINT64 clocks;
+  UINT64 start;
+
+public:
+  ProfileScope(Profiler* p, int id_, UINT64 clocks_)
+    : profiler(p), id(id_), clocks(clocks_), start(p ? Profiler::Now() : 0)
+  {}
+
+  ~ProfileScope()
+  {
+    if (profiler) profiler->Add(id, Profiler::Now() - start, clocks);
+  }
+};
+
+#if NSFPLAY_PROFILE
+  #define PROFILE_SCOPE(p,id,clocks) ProfileScope profile_scope_((p),(id),(clocks))
+  #define PROFILE_SAMPLES(p,n)       (p)->AddSamples(n)
+  #define PROFILE_BUS_READ(p,d)      if (p) (p)->BusRead(d)
+  #define PROFILE_BUS_WRITE(p,d)     if (p) (p)->BusWrite(d)
+#else
+  #define PROFILE_SCOPE(p,id,clocks)
+  #define PROFILE_SAMPLES(p,n)
+  #define PROFILE_BUS_READ(p,d)
+  #define PROFILE_BUS_WRITE(p,d)
+#endif
+
+} // namespace xgm
+
+#endif
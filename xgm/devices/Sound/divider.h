@@ -0,0 +1,70 @@
+#ifndef _DIVIDER_H_
+#define _DIVIDER_H_
+#include "../../xtypes.h"
+
+namespace xgm
+{
+  // Phase steps taken by a period divider during one Tick.
+  // Step k (0 <= k < count) happened at clock first + k*period of the batch,
+  // counting from 1. first can be <= 0 if the divider was already overdue
+  // when the batch started (e.g. a randomized reset), in which case those
+  // steps belong at the very start of the batch.
+  // This is what a band-limited synthesizer needs to place each edge.
+  struct DividerSteps
+  {
+    UINT32 count;
+    INT32 first;
+    UINT32 period;
+  };
+
+  // Counts down by clocks, stepping and reloading with period whenever it
+  // falls below zero. Same result as the step-by-step loop
+  //   counter -= clocks; while (counter < 0) { ++n; counter += period; }
+  // in constant time. Returns the number of steps.
+  inline UINT32 DivideDown (INT32 & counter, UINT32 clocks, UINT32 period, DividerSteps & steps)
+  {
+    INT32 start = counter;
+    INT32 c = start - INT32(clocks);
+    UINT32 n = 0;
+    if (c < 0)
+    {
+      n = (UINT32(-c) + period - 1) / period;
+      c += INT32(n * period);
+    }
+    counter = c;
+    steps.count = n;
+    steps.first = start + 1;
+    steps.period = period;
+    return n;
+  }
+
+  // Counts up by clocks, stepping whenever it passes limit and then
+  // subtracting limit+1. Same result as
+  //   counter += clocks; while (counter > limit) { ++n; counter -= limit+1; }
+  inline UINT32 DivideUp (UINT32 & counter, UINT32 clocks, UINT32 limit, DividerSteps & steps)
+  {
+    UINT32 period = limit + 1;
+    UINT32 start = counter;
+    UINT32 c = start + clocks;
+    UINT32 n = 0;
+    if (c > limit)
+    {
+      n = (c - limit + period - 1) / period;
+      c -= n * period;
+    }
+    counter = c;
+    steps.count = n;
+    steps.first = INT32(limit) - INT32(start) + 1;
+    steps.period = period;
+    return n;
+  }
+
+  inline void NoDividerSteps (DividerSteps & steps)
+  {
+    steps.count = 0;
+    steps.first = 0;
+    steps.period = 0;
+  }
+}                               // namespace
+
+#endif
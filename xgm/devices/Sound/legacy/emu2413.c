@@ -29,7 +29,7 @@
 #define _PI_ 3.14159265358979323846264338327950288
 
 #define OPLL_TONE_NUM 10
-static unsigned char default_inst[OPLL_TONE_NUM][(16 + 3) * 8] = {
+static const unsigned char default_inst[OPLL_TONE_NUM][(16 + 3) * 8] = {
   {
 #include "vrc7tone_nuke.h"
   },
@@ -92,7 +92,7 @@ static unsigned char default_inst[OPLL_TONE_NUM][(16 + 3) * 8] = {
 
 /* clang-format off */
 /* exp_table[x] = round((exp2((double)x / 256.0) - 1) * 1024) */
-static uint16_t exp_table[256] = {
+static const uint16_t exp_table[256] = {
 0,    3,    6,    8,    11,   14,   17,   20,   22,   25,   28,   31,   34,   37,   40,   42,
 45,   48,   51,   54,   57,   60,   63,   66,   69,   72,   75,   78,   81,   84,   87,   90,
 93,   96,   99,   102,  105,  108,  111,  114,  117,  120,  123,  126,  130,  133,  136,  139,
@@ -110,33 +110,16 @@ static uint16_t exp_table[256] = {
 854,  859,  864,  869,  874,  880,  885,  890,  895,  900,  906,  911,  916,  921,  927,  932,
 937,  942,  948,  953,  959,  964,  969,  975,  980,  986,  991,  996, 1002, 1007, 1013, 1018
 };
-/* fullsin_table[x] = round(-log2(sin((x + 0.5) * PI / (PG_WIDTH / 4) / 2)) * 256) */
-static uint16_t fullsin_table[PG_WIDTH] = {
-2137, 1731, 1543, 1419, 1326, 1252, 1190, 1137, 1091, 1050, 1013, 979,  949,  920,  894,  869, 
-846,  825,  804,  785,  767,  749,  732,  717,  701,  687,  672,  659,  646,  633,  621,  609, 
-598,  587,  576,  566,  556,  546,  536,  527,  518,  509,  501,  492,  484,  476,  468,  461,
-453,  446,  439,  432,  425,  418,  411,  405,  399,  392,  386,  380,  375,  369,  363,  358,  
-352,  347,  341,  336,  331,  326,  321,  316,  311,  307,  302,  297,  293,  289,  284,  280,
-276,  271,  267,  263,  259,  255,  251,  248,  244,  240,  236,  233,  229,  226,  222,  219, 
-215,  212,  209,  205,  202,  199,  196,  193,  190,  187,  184,  181,  178,  175,  172,  169, 
-167,  164,  161,  159,  156,  153,  151,  148,  146,  143,  141,  138,  136,  134,  131,  129,  
-127,  125,  122,  120,  118,  116,  114,  112,  110,  108,  106,  104,  102,  100,  98,   96,   
-94,   92,   91,   89,   87,   85,   83,   82,   80,   78,   77,   75,   74,   72,   70,   69,
-67,   66,   64,   63,   62,   60,   59,   57,   56,   55,   53,   52,   51,   49,   48,   47,  
-46,   45,   43,   42,   41,   40,   39,   38,   37,   36,   35,   34,   33,   32,   31,   30,  
-29,   28,   27,   26,   25,   24,   23,   23,   22,   21,   20,   20,   19,   18,   17,   17,   
-16,   15,   15,   14,   13,   13,   12,   12,   11,   10,   10,   9,    9,    8,    8,    7,    
-7,    7,    6,    6,    5,    5,    5,    4,    4,    4,    3,    3,    3,    2,    2,    2,
-2,    1,    1,    1,    1,    1,    1,    1,    0,    0,    0,    0,    0,    0,    0,    0,
-};
 /* clang-format on */
 
-static uint16_t halfsin_table[PG_WIDTH];
-static uint16_t *wave_table_map[2] = {fullsin_table, halfsin_table};
+/* indexed by patch WS: full sine and half sine */
+static const uint16_t wave_table_map[2][PG_WIDTH] = {
+#include "2413wave.h"
+};
 
 /* pitch modulator */
 /* offset to fnum, rough approximation of 14 cents depth. */
-static int8_t pm_table[8][8] = {
+static const int8_t pm_table[8][8] = {
     {0, 0, 0, 0, 0, 0, 0, 0},    // fnum = 000xxxxxx
     {0, 0, 1, 0, 0, 0, -1, 0},   // fnum = 001xxxxxx
     {0, 1, 2, 1, 0, -1, -2, -1}, // fnum = 010xxxxxx
@@ -150,7 +133,7 @@ static int8_t pm_table[8][8] = {
 /* amplitude lfo table */
 /* The following envelop pattern is verified on real YM2413. */
 /* each element repeates 64 cycles */
-static uint8_t am_table[210] = {0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,  //
+static const uint8_t am_table[210] = {0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  1,  1,  1,  //
                                 2,  2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  3,  3,  3,  //
                                 4,  4,  4,  4,  4,  4,  4,  4,  5,  5,  5,  5,  5,  5,  5,  5,  //
                                 6,  6,  6,  6,  6,  6,  6,  6,  7,  7,  7,  7,  7,  7,  7,  7,  //
@@ -168,7 +151,7 @@ static uint8_t am_table[210] = {0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
 
 /* envelope decay increment step table */
 /* based on andete's research */
-static uint8_t eg_step_tables[4][8] = {
+static const uint8_t eg_step_tables[4][8] = {
     {0, 1, 0, 1, 0, 1, 0, 1},
     {0, 1, 0, 1, 1, 1, 0, 1},
     {0, 1, 1, 1, 0, 1, 1, 1},
@@ -177,19 +160,15 @@ static uint8_t eg_step_tables[4][8] = {
 
 enum __OPLL_EG_STATE { ATTACK, DECAY, SUSTAIN, RELEASE, DAMP, UNKNOWN };
 
-static uint32_t ml_table[16] = {1,     1 * 2, 2 * 2,  3 * 2,  4 * 2,  5 * 2,  6 * 2,  7 * 2,
-                                8 * 2, 9 * 2, 10 * 2, 10 * 2, 12 * 2, 12 * 2, 15 * 2, 15 * 2};
+static const uint32_t ml_table[16] = {1,     1 * 2, 2 * 2,  3 * 2,  4 * 2,  5 * 2,  6 * 2,  7 * 2,
+                                      8 * 2, 9 * 2, 10 * 2, 10 * 2, 12 * 2, 12 * 2, 15 * 2, 15 * 2};
 
 #define dB2(x) ((x)*2)
-static double kl_table[16] = {dB2(0.000),  dB2(9.000),  dB2(12.000), dB2(13.875), dB2(15.000), dB2(16.125),
-                              dB2(16.875), dB2(17.625), dB2(18.000), dB2(18.750), dB2(19.125), dB2(19.500),
-                              dB2(19.875), dB2(20.250), dB2(20.625), dB2(21.000)};
+static const double kl_table[16] = {dB2(0.000),  dB2(9.000),  dB2(12.000), dB2(13.875), dB2(15.000), dB2(16.125),
+                                    dB2(16.875), dB2(17.625), dB2(18.000), dB2(18.750), dB2(19.125), dB2(19.500),
+                                    dB2(19.875), dB2(20.250), dB2(20.625), dB2(21.000)};
 
-static uint32_t tll_table[8 * 16][1 << TL_BITS][4];
-static int32_t rks_table[8 * 2][2];
-
-static OPLL_PATCH null_patch = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static OPLL_PATCH default_patch[OPLL_TONE_NUM][(16 + 3) * 2];
+static const OPLL_PATCH null_patch = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 /* don't forget min/max is defined as a macro in stdlib.h of Visual C. */
 #ifndef min
@@ -311,74 +290,29 @@ void OPLL_RateConv_delete(OPLL_RateConv *conv) {
 
 ****************************************************/
 
-static void makeSinTable(void) {
-  int x;
-
-  for (x = 0; x < PG_WIDTH / 4; x++) {
-    fullsin_table[PG_WIDTH / 4 + x] = fullsin_table[PG_WIDTH / 4 - x - 1];
-  }
-
-  for (x = 0; x < PG_WIDTH / 2; x++) {
-    fullsin_table[PG_WIDTH / 2 + x] = 0x8000 | fullsin_table[x];
-  }
-
-  for (x = 0; x < PG_WIDTH / 2; x++)
-    halfsin_table[x] = fullsin_table[x];
-
-  for (x = PG_WIDTH / 2; x < PG_WIDTH; x++)
-    halfsin_table[x] = 0xfff;
-}
-
-static void makeTllTable(void) {
+/* All tables are constant, so any number of OPLL instances can be created
+ * and run on different threads. The key scale tables that upstream builds
+ * on first use are cheap enough to compute when a slot is updated. */
 
+/* total level + key scale level, for blk_fnum >> 5 */
+static uint32_t calc_tll(int32_t blk_fnum4, int32_t TL, int32_t KL) {
+  const int32_t fnum = blk_fnum4 & 15;
+  const int32_t block = blk_fnum4 >> 4;
   int32_t tmp;
-  int32_t fnum, block, TL, KL;
-
-  for (fnum = 0; fnum < 16; fnum++) {
-    for (block = 0; block < 8; block++) {
-      for (TL = 0; TL < 64; TL++) {
-        for (KL = 0; KL < 4; KL++) {
-          if (KL == 0) {
-            tll_table[(block << 4) | fnum][TL][KL] = TL2EG(TL);
-          } else {
-            tmp = (int32_t)(kl_table[fnum] - dB2(3.000) * (7 - block));
-            if (tmp <= 0)
-              tll_table[(block << 4) | fnum][TL][KL] = TL2EG(TL);
-            else
-              tll_table[(block << 4) | fnum][TL][KL] = (uint32_t)((tmp >> (3 - KL)) / EG_STEP) + TL2EG(TL);
-          }
-        }
-      }
-    }
-  }
-}
 
-static void makeRksTable(void) {
-  int fnum8, block;
-  for (fnum8 = 0; fnum8 < 2; fnum8++)
-    for (block = 0; block < 8; block++) {
-      rks_table[(block << 1) | fnum8][1] = (block << 1) + fnum8;
-      rks_table[(block << 1) | fnum8][0] = block >> 1;
-    }
-}
+  if (KL == 0)
+    return TL2EG(TL);
 
-static void makeDefaultPatch(void) {
-  int i, j;
-  for (i = 0; i < OPLL_TONE_NUM; i++)
-    for (j = 0; j < 19; j++)
-      OPLL_getDefaultPatch(i, j, &default_patch[i][j * 2]);
-}
+  tmp = (int32_t)(kl_table[fnum] - dB2(3.000) * (7 - block));
+  if (tmp <= 0)
+    return TL2EG(TL);
 
-static uint8_t table_initialized = 0;
-
-static void initializeTables(void) {
-  makeTllTable();
-  makeRksTable();
-  makeSinTable();
-  makeDefaultPatch();
-  table_initialized = 1;
+  return (uint32_t)((tmp >> (3 - KL)) / EG_STEP) + TL2EG(TL);
 }
 
+/* key scale offset for eg speed, for blk_fnum >> 8 */
+static INLINE int32_t calc_rks(int32_t blk_fnum8, int32_t KR) { return KR ? blk_fnum8 : (blk_fnum8 >> 2); }
+
 /*********************************************************
 
                       Synthesizing
@@ -484,14 +418,14 @@ static void commit_slot_update(OPLL_SLOT *slot) {
 
   if (slot->update_requests & UPDATE_TLL) {
     if ((slot->type & 1) == 0) {
-      slot->tll = tll_table[slot->blk_fnum >> 5][slot->patch->TL][slot->patch->KL];
+      slot->tll = calc_tll(slot->blk_fnum >> 5, slot->patch->TL, slot->patch->KL);
     } else {
-      slot->tll = tll_table[slot->blk_fnum >> 5][slot->volume][slot->patch->KL];
+      slot->tll = calc_tll(slot->blk_fnum >> 5, slot->volume, slot->patch->KL);
     }
   }
 
   if (slot->update_requests & UPDATE_RKS) {
-    slot->rks = rks_table[slot->blk_fnum >> 8][slot->patch->KR];
+    slot->rks = calc_rks(slot->blk_fnum >> 8, slot->patch->KR);
   }
 
   if (slot->update_requests & (UPDATE_RKS | UPDATE_EG)) {
@@ -521,7 +455,6 @@ static void reset_slot(OPLL_SLOT *slot, int number) {
   slot->type = number % 2;
   slot->pg_keep = 0;
   slot->wave_table = wave_table_map[0];
-  slot->pg_phase = 0;
   slot->output[0] = 0;
   slot->output[1] = 0;
   slot->eg_state = RELEASE;
@@ -534,7 +467,6 @@ static void reset_slot(OPLL_SLOT *slot, int number) {
   slot->blk = 0;
   slot->fnum = 0;
   slot->volume = 0;
-  slot->pg_out = 0;
   slot->eg_out = EG_MUTE;
   slot->patch = &null_patch;
 }
@@ -707,8 +639,8 @@ static void update_noise(OPLL *opll, int cycle) {
 }
 
 static void update_short_noise(OPLL *opll) {
-  const uint32_t pg_hh = opll->slot[SLOT_HH].pg_out;
-  const uint32_t pg_cym = opll->slot[SLOT_CYM].pg_out;
+  const uint32_t pg_hh = opll->pg_out[SLOT_HH];
+  const uint32_t pg_cym = opll->pg_out[SLOT_CYM];
 
   const uint8_t h_bit2 = BIT(pg_hh, PG_BITS - 8);
   const uint8_t h_bit7 = BIT(pg_hh, PG_BITS - 3);
@@ -720,14 +652,29 @@ static void update_short_noise(OPLL *opll) {
   opll->short_noise = (h_bit2 ^ h_bit7) | (h_bit3 ^ c_bit5) | (c_bit3 ^ c_bit5);
 }
 
-static INLINE void calc_phase(OPLL_SLOT *slot, int32_t pm_phase, uint8_t reset) {
-  const int8_t pm = slot->patch->PM ? pm_table[(slot->fnum >> 6) & 7][(pm_phase >> 10) & 7] : 0;
+/* The phase increment of a slot only changes with its f-number, block and
+ * patch, or when the pm phase moves to the next pm_table column (every 1024
+ * samples), so it is cached in pg_step. */
+static void update_pg_steps(OPLL *opll, int32_t pm) {
+  int i;
+  for (i = 0; i < 18; i++) {
+    const OPLL_SLOT *slot = &opll->slot[i];
+    const int8_t d = slot->patch->PM ? pm_table[(slot->fnum >> 6) & 7][pm] : 0;
+    opll->pg_step[i] = (((slot->fnum & 0x1ff) * 2 + d) * ml_table[slot->patch->ML]) << slot->blk >> 2;
+  }
+  opll->pg_step_pm = pm;
+}
+
+static INLINE void calc_phases(OPLL *opll, uint8_t reset) {
+  int i;
   if (reset) {
-    slot->pg_phase = 0;
+    memset(opll->pg_phase, 0, sizeof(opll->pg_phase));
+  }
+  for (i = 0; i < 20; i++) {
+    const uint32_t phase = (opll->pg_phase[i] + (uint32_t)opll->pg_step[i]) & (DP_WIDTH - 1);
+    opll->pg_phase[i] = phase;
+    opll->pg_out[i] = phase >> DP_BASE_BITS;
   }
-  slot->pg_phase += (((slot->fnum & 0x1ff) * 2 + pm) * ml_table[slot->patch->ML]) << slot->blk >> 2;
-  slot->pg_phase &= (DP_WIDTH - 1);
-  slot->pg_out = slot->pg_phase >> DP_BASE_BITS;
 }
 
 static INLINE uint8_t lookup_attack_step(OPLL_SLOT *slot, uint32_t counter) {
@@ -782,7 +729,7 @@ static INLINE void start_envelope(OPLL_SLOT *slot) {
   request_update(slot, UPDATE_EG);
 }
 
-static INLINE void calc_envelope(OPLL_SLOT *slot, OPLL_SLOT *buddy, uint16_t eg_counter, uint8_t test) {
+static INLINE void calc_envelope(OPLL *opll, OPLL_SLOT *slot, OPLL_SLOT *buddy, uint16_t eg_counter, uint8_t test) {
 
   uint32_t mask = (1 << slot->eg_shift) - 1;
   uint8_t s;
@@ -808,10 +755,12 @@ static INLINE void calc_envelope(OPLL_SLOT *slot, OPLL_SLOT *buddy, uint16_t eg_
       start_envelope(slot);
       if (slot->type & 1) {
         if (!slot->pg_keep) {
-          slot->pg_phase = 0;
+          opll->pg_phase[slot->number] = 0;
         }
         if (buddy && !buddy->pg_keep) {
-          buddy->pg_phase = 0;
+          // the buddy is the modulator before this slot, whose phase was
+          // already advanced in this cycle: clear it after the update.
+          opll->pg_reset |= 1 << buddy->number;
         }
       }
     }
@@ -844,24 +793,48 @@ static INLINE void calc_envelope(OPLL_SLOT *slot, OPLL_SLOT *buddy, uint16_t eg_
   }
 }
 
+/* calc_envelope has nothing to do in SUSTAIN or RELEASE when the envelope
+ * does not move or is already muted, which is where most slots spend most
+ * of their time. */
+static INLINE int is_envelope_idle(OPLL_SLOT *slot) {
+  return (slot->eg_state == SUSTAIN || slot->eg_state == RELEASE) &&
+         (slot->eg_rate_h == 0 || slot->eg_out == EG_MUTE);
+}
+
 static void update_slots(OPLL *opll) {
+  const int32_t pm = (opll->pm_phase >> 10) & 7;
   int i;
   opll->eg_counter++;
 
   for (i = 0; i < 18; i++) {
     OPLL_SLOT *slot = &opll->slot[i];
     OPLL_SLOT *buddy = NULL;
+    if (slot->update_requests) {
+      commit_slot_update(slot);
+    }
+    if (is_envelope_idle(slot) && !(opll->test_flag & 1)) {
+      continue;
+    }
     if (slot->type == 0) {
       buddy = &opll->slot[i + 1];
     }
     if (slot->type == 1) {
       buddy = &opll->slot[i - 1];
     }
-    if (slot->update_requests) {
-      commit_slot_update(slot);
+    calc_envelope(opll, slot, buddy, opll->eg_counter, opll->test_flag & 1);
+  }
+
+  if (opll->pg_step_pm != pm) {
+    update_pg_steps(opll, pm);
+  }
+  calc_phases(opll, opll->test_flag & 4);
+  if (opll->pg_reset) {
+    for (i = 0; i < 18; i++) {
+      if (BIT(opll->pg_reset, i)) {
+        opll->pg_phase[i] = 0;
+      }
     }
-    calc_envelope(slot, buddy, opll->eg_counter, opll->test_flag & 1);
-    calc_phase(slot, opll->pm_phase, opll->test_flag & 4);
+    opll->pg_reset = 0;
   }
 }
 
@@ -888,7 +861,7 @@ static INLINE int16_t calc_slot_car(OPLL *opll, int ch, int16_t fm) {
   uint8_t am = slot->patch->AM ? opll->lfo_am : 0;
 
   slot->output[1] = slot->output[0];
-  slot->output[0] = to_linear(slot->wave_table[(slot->pg_out + 2 * (fm >> 1)) & (PG_WIDTH - 1)], slot, am);
+  slot->output[0] = to_linear(slot->wave_table[(opll->pg_out[slot->number] + 2 * (fm >> 1)) & (PG_WIDTH - 1)], slot, am);
 
   return slot->output[0];
 }
@@ -900,7 +873,7 @@ static INLINE int16_t calc_slot_mod(OPLL *opll, int ch) {
   uint8_t am = slot->patch->AM ? opll->lfo_am : 0;
 
   slot->output[1] = slot->output[0];
-  slot->output[0] = to_linear(slot->wave_table[(slot->pg_out + fm) & (PG_WIDTH - 1)], slot, am);
+  slot->output[0] = to_linear(slot->wave_table[(opll->pg_out[slot->number] + fm) & (PG_WIDTH - 1)], slot, am);
 
   return slot->output[0];
 }
@@ -908,7 +881,7 @@ static INLINE int16_t calc_slot_mod(OPLL *opll, int ch) {
 static INLINE int16_t calc_slot_tom(OPLL *opll) {
   OPLL_SLOT *slot = MOD(opll, 8);
 
-  return to_linear(slot->wave_table[slot->pg_out], slot, 0);
+  return to_linear(slot->wave_table[opll->pg_out[slot->number]], slot, 0);
 }
 
 /* Specify phase offset directly based on 10-bit (1024-length) sine table */
@@ -919,7 +892,7 @@ static INLINE int16_t calc_slot_snare(OPLL *opll) {
 
   uint32_t phase;
 
-  if (BIT(slot->pg_out, PG_BITS - 2))
+  if (BIT(opll->pg_out[slot->number], PG_BITS - 2))
     phase = (opll->noise & 1) ? _PD(0x300) : _PD(0x200);
   else
     phase = (opll->noise & 1) ? _PD(0x0) : _PD(0x100);
@@ -951,13 +924,17 @@ static INLINE int16_t calc_slot_hat(OPLL *opll) {
 #define _MO(x) (-(x) >> 1)
 #define _RO(x) (x)
 
+static void update_state(OPLL *opll) {
+  update_ampm(opll);
+  update_short_noise(opll);
+  update_slots(opll);
+}
+
 static void update_output(OPLL *opll) {
   int16_t *out;
   int i;
 
-  update_ampm(opll);
-  update_short_noise(opll);
-  update_slots(opll);
+  update_state(opll);
 
   out = opll->ch_out;
 
@@ -1050,9 +1027,6 @@ OPLL *OPLL_new(uint32_t clk, uint32_t rate) {
   OPLL *opll;
   int i;
 
-  if (!table_initialized) {
-    initializeTables();
-  }
 
   opll = (OPLL *)calloc(sizeof(OPLL), 1);
   if (opll == NULL)
@@ -1127,6 +1101,12 @@ void OPLL_reset(OPLL *opll) {
   for (i = 0; i < 18; i++)
     reset_slot(&opll->slot[i], i);
 
+  memset(opll->pg_phase, 0, sizeof(opll->pg_phase));
+  memset(opll->pg_out, 0, sizeof(opll->pg_out));
+  memset(opll->pg_step, 0, sizeof(opll->pg_step));
+  opll->pg_step_pm = -1;
+  opll->pg_reset = 0;
+
   for (i = 0; i < 9; i++) {
     set_patch(opll, i, 0);
   }
@@ -1157,6 +1137,7 @@ void OPLL_forceRefresh(OPLL *opll) {
   for (i = 0; i < 18; i++) {
     request_update(&opll->slot[i], UPDATE_ALL);
   }
+  opll->pg_step_pm = -1;
 }
 
 void OPLL_setRate(OPLL *opll, uint32_t rate) {
@@ -1180,6 +1161,7 @@ void OPLL_writeReg(OPLL *opll, uint32_t reg, uint8_t data) {
   }
 
   opll->reg[reg] = (uint8_t)data;
+  opll->pg_step_pm = -1;
 
   switch (reg) {
   case 0x00:
@@ -1397,6 +1379,7 @@ void OPLL_setPatch(OPLL *opll, const uint8_t *dump) {
     memcpy(&opll->patch[i * 2 + 0], &patch[0], sizeof(OPLL_PATCH));
     memcpy(&opll->patch[i * 2 + 1], &patch[1], sizeof(OPLL_PATCH));
   }
+  opll->pg_step_pm = -1;
 }
 
 void OPLL_patchToDump(const OPLL_PATCH *patch, uint8_t *dump) {
@@ -1412,12 +1395,14 @@ void OPLL_patchToDump(const OPLL_PATCH *patch, uint8_t *dump) {
 
 void OPLL_copyPatch(OPLL *opll, int32_t num, OPLL_PATCH *patch) {
   memcpy(&opll->patch[num], patch, sizeof(OPLL_PATCH));
+  opll->pg_step_pm = -1;
 }
 
 void OPLL_resetPatch(OPLL *opll, uint8_t type) {
   int i;
-  for (i = 0; i < 19 * 2; i++)
-    OPLL_copyPatch(opll, i, &default_patch[type % OPLL_TONE_NUM][i]);
+  for (i = 0; i < 19; i++)
+    OPLL_getDefaultPatch(type % OPLL_TONE_NUM, i, &opll->patch[i * 2]);
+  opll->pg_step_pm = -1;
 }
 
 int16_t OPLL_calc(OPLL *opll) {
@@ -1433,6 +1418,17 @@ int16_t OPLL_calc(OPLL *opll) {
   return opll->mix_out[0];
 }
 
+/* The slot outputs only feed back into the modulators, which restart from
+ * the current phase once output is calculated again. */
+void OPLL_calcState(OPLL *opll) {
+  while (opll->out_step > opll->out_time) {
+    opll->out_time += opll->inp_step;
+    update_state(opll);
+    update_noise(opll, 18);
+  }
+  opll->out_time -= opll->out_step;
+}
+
 void OPLL_calcStereo(OPLL *opll, int32_t out[2]) {
   while (opll->out_step > opll->out_time) {
     opll->out_time += opll->inp_step;
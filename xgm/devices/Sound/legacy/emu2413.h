@@ -38,15 +38,13 @@ typedef struct __OPLL_SLOT {
    */
   uint8_t type;
 
-  OPLL_PATCH *patch; /* voice parameter */
+  const OPLL_PATCH *patch; /* voice parameter */
 
   /* slot output */
   int32_t output[2]; /* output value, latest and previous. */
 
-  /* phase generator (pg) */
-  uint16_t *wave_table; /* wave table */
-  uint32_t pg_phase;    /* pg phase */
-  uint32_t pg_out;      /* pg output, as index of wave table */
+  /* phase generator (pg), phase and output are in OPLL.pg_phase/pg_out */
+  const uint16_t *wave_table; /* wave table */
   uint8_t pg_keep;      /* if 1, pg_phase is preserved when key-on */
   uint16_t blk_fnum;    /* (block << 9) | f-number */
   uint16_t fnum;        /* f-number (9 bits) */
@@ -124,6 +122,15 @@ typedef struct __OPLL {
 
   int32_t patch_number[9];
   OPLL_SLOT slot[18];
+
+  /* phase generators of all slots, stored as arrays so that they are
+   * advanced together in one loop the compiler can vectorize.
+   * Padded to a multiple of 4, the last two entries are unused. */
+  uint32_t pg_phase[20]; /* pg phase */
+  uint32_t pg_out[20];   /* pg output, as index of wave table */
+  int32_t pg_step[20];   /* phase increment for the current pm phase */
+  int32_t pg_step_pm;    /* pm phase pg_step was computed for, -1 after any register or patch change */
+  uint32_t pg_reset;     /* bit per slot, phase is cleared after the next phase update */
   OPLL_PATCH patch[19 * 2];
 
   uint8_t pan[16];
@@ -200,6 +207,12 @@ int16_t OPLL_calc(OPLL *opll);
  */
 void OPLL_calcStereo(OPLL *opll, int32_t out[2]);
 
+/**
+ * Advance the chip like OPLL_calc without calculating any output.
+ * Envelopes, phases, LFOs and noise keep running; ch_out is left as it was.
+ */
+void OPLL_calcState(OPLL *opll);
+
 void OPLL_setPatch(OPLL *, const uint8_t *dump);
 void OPLL_copyPatch(OPLL *, int32_t, OPLL_PATCH *);
 
@@ -95,12 +95,8 @@ namespace xgm
       {1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
     };
 
-    scounter[i] -= clocks;
-    while (scounter[i] < 0)
-    {
-        sphase[i] = (sphase[i] + 1) & 15;
-        scounter[i] += freq[i] + 1;
-    }
+    UINT32 steps = DivideDown(scounter[i], clocks, freq[i] + 1, ssteps[i]);
+    sphase[i] = (sphase[i] + steps) & 15;
 
     INT32 ret = 0;
     if (length_counter[i] > 0 &&
@@ -147,20 +143,8 @@ namespace xgm
 
     if(option[OPT_NONLINEAR_MIXER])
     {
-        INT32 voltage = square_table[out[0] + out[1]];
-        m[0] = out[0] << 6;
-        m[1] = out[1] << 6;
-        INT32 ref = m[0] + m[1];
-        if (ref > 0)
-        {
-            m[0] = (m[0] * voltage) / ref;
-            m[1] = (m[1] * voltage) / ref;
-        }
-        else
-        {
-            m[0] = voltage;
-            m[1] = voltage;
-        }
+        m[0] = square_mix[out[0]][out[1]][0];
+        m[1] = square_mix[out[0]][out[1]][1];
     }
     else
     {
@@ -195,6 +179,18 @@ namespace xgm
 
     square_linear = square_table[15]; // match linear scale to one full volume square of nonlinear
 
+    // each square's share of the combined voltage, in proportion to its level
+    for(int a=0;a<16;a++)
+    {
+        for(int b=0;b<16;b++)
+        {
+            INT32 voltage = square_table[a + b];
+            INT32 ref = a + b;
+            square_mix[a][b][0] = ref ? (a * voltage) / ref : voltage;
+            square_mix[a][b][1] = ref ? (b * voltage) / ref : voltage;
+        }
+    }
+
     for(int c=0;c<2;++c)
         for(int t=0;t<2;++t)
             sm[c][t] = 128;
@@ -214,6 +210,7 @@ namespace xgm
     {
         scounter[i] = 0;
         sphase[i] = 0;
+        NoDividerSteps(ssteps[i]);
         duty[i] = 0;
         volume[i] = 0;
         freq[i] = 0;
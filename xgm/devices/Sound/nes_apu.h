@@ -2,6 +2,7 @@
 #define _NES_APU_H_
 #include "../device.h"
 #include "nes_dmc.h"
+#include "divider.h"
 
 namespace xgm
 {
@@ -32,10 +33,12 @@ namespace xgm
     double rate, clock;
 
     INT32 square_table[32];     // nonlinear mixer
+    INT32 square_mix[16][16][2]; // nonlinear mixer split between the squares
     INT32 square_linear;        // linear mix approximation
 
     int scounter[2];            // frequency divider
     int sphase[2];              // phase counter
+    DividerSteps ssteps[2];     // phase steps of the last Tick
 
     int duty[2];
     int volume[2];
@@ -81,6 +84,9 @@ namespace xgm
     virtual void SetMask(int m){ mask = m; }
     virtual void SetStereoMix (int trk, xgm::INT16 mixl, xgm::INT16 mixr);
     virtual ITrackInfo *GetTrackInfo(int trk);
+
+    // phase steps of square trk during the last Tick
+    const DividerSteps & GetDividerSteps(int trk) const { return ssteps[trk]; }
   };
 
 }                               // namespace
@@ -1,9 +1,17 @@
 #include "nes_dmc.h"
 #include "nes_apu.h"
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 namespace xgm
 {
+  // default nonlinear mixer weights for triangle, noise and DMC
+  static const double TND_WT = 8227, TND_WN = 12241, TND_WD = 22638;
+
   const UINT32 NES_DMC::wavlen_table[2][16] = {
   { // NTSC
     4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
@@ -39,6 +47,87 @@ namespace xgm
     0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF,
   };
 
+  // The noise LFSR permutes its 15-bit states into cycles (one of 32767
+  // states plus 0 in the long mode, 93 or 31 states in the short mode).
+  // The cycles are stored one after another so the register can be
+  // advanced any number of steps at once, with a prefix count of the
+  // states whose output bit ($4000) is clear for the averaged output.
+  // Built on first use for each mode, immutable afterwards.
+  class NoiseSequence
+  {
+  protected:
+    struct Cycle
+    {
+      UINT32 start;  // position of the first state in order[]
+      UINT32 length;
+      UINT32 zeros;  // states in the cycle with the output bit clear
+    };
+
+    UINT16 order[0x8000];    // states, cycle by cycle
+    UINT16 index[0x8000];    // state -> position in order[]
+    UINT16 cycle_of[0x8000]; // state -> cycle
+    UINT16 zeros[0x8001];    // zeros[i] = states in order[0..i-1] with the output bit clear
+    std::vector<Cycle> cycle;
+
+    // output-clear states at cycle positions [0,i), i < 2*length
+    UINT32 Prefix(const Cycle& c, UINT32 i) const
+    {
+      if (i > c.length) return c.zeros + Prefix(c, i - c.length);
+      return UINT32(zeros[c.start + i] - zeros[c.start]);
+    }
+
+  public:
+    NoiseSequence(UINT32 tap)
+    {
+      for (UINT32 s = 0; s < 0x8000; ++s) index[s] = 0xFFFF;
+      UINT32 pos = 0;
+      for (UINT32 s = 0; s < 0x8000; ++s)
+      {
+        if (index[s] != 0xFFFF) continue;
+        Cycle c = { pos, 0, 0 };
+        UINT32 x = s;
+        do
+        {
+          order[pos] = UINT16(x);
+          index[x] = UINT16(pos);
+          cycle_of[x] = UINT16(cycle.size());
+          ++pos;
+          UINT32 feedback = (x&1) ^ ((x&tap)?1:0);
+          x = (x>>1) | (feedback<<14);
+        } while (x != s);
+        c.length = pos - c.start;
+        cycle.push_back(c);
+      }
+      zeros[0] = 0;
+      for (UINT32 i = 0; i < 0x8000; ++i)
+        zeros[i+1] = zeros[i] + ((order[i] & 0x4000) ? 0 : 1);
+      for (size_t i = 0; i < cycle.size(); ++i)
+        cycle[i].zeros = zeros[cycle[i].start + cycle[i].length] - zeros[cycle[i].start];
+    }
+
+    // steps the 15-bit state, returns how many of the new states have the output bit clear
+    UINT32 Advance(UINT32& state, UINT32 steps) const
+    {
+      const Cycle& c = cycle[cycle_of[state]];
+      UINT32 p = index[state] - c.start;
+      UINT32 rem = steps % c.length;
+      UINT32 count = (steps / c.length) * c.zeros + Prefix(c, p + 1 + rem) - Prefix(c, p + 1);
+      state = order[c.start + ((p + rem) % c.length)];
+      return count;
+    }
+
+    static const NoiseSequence& Get(UINT32 tap)
+    {
+      if (tap == (1<<6))
+      {
+        static const NoiseSequence short_sequence(1<<6);
+        return short_sequence;
+      }
+      static const NoiseSequence long_sequence(1<<1);
+      return long_sequence;
+    }
+  };
+
   NES_DMC::NES_DMC () : GETA_BITS (20)
   {
     SetClock (DEFAULT_CLOCK);
@@ -53,8 +142,7 @@ namespace xgm
 	option[OPT_RANDOMIZE_TRI] = 1;
     option[OPT_TRI_MUTE] = 1;
     option[OPT_DPCM_REVERSE] = 0;
-    tnd_table[0][0][0][0] = 0;
-    tnd_table[1][0][0][0] = 0;
+    InitializeTNDTable(TND_WT,TND_WN,TND_WD);
 
     apu = NULL;
     frame_sequence_count = 0;
@@ -196,7 +284,7 @@ namespace xgm
   // �O�p�g�`�����l���̌v�Z �߂�l��0-15
   UINT32 NES_DMC::calc_tri (UINT32 clocks)
   {
-    static UINT32 tritbl[32] = 
+    static const UINT32 tritbl[32] = 
     {
      15,14,13,12,11,10, 9, 8,
       7, 6, 5, 4, 3, 2, 1, 0,
@@ -204,7 +292,7 @@ namespace xgm
       8, 9,10,11,12,13,14,15,
     };
 
-    static UINT32 triggertbl[32] =
+    static const UINT32 triggertbl[32] =
     {
       0, 0, 0, 0, 0, 0, 0, 0,
       0, 0, 0, 0, 0, 0, 0, 0,
@@ -215,13 +303,11 @@ namespace xgm
     if (linear_counter > 0 && length_counter[0] > 0
         && (!option[OPT_TRI_MUTE] || tri_freq > 0))
     {
-      counter[0] -= clocks;
-      while (counter[0] < 0)
-      {
-        tphase = (tphase + 1) & 31;
-        counter[0] += (tri_freq + 1);
-      }
+      UINT32 steps = DivideDown(counter[0], clocks, tri_freq + 1, tsteps);
+      tphase = (tphase + steps) & 31;
     }
+    else
+      NoDividerSteps(tsteps);
 
     UINT32 ret = trigger ? triggertbl[tphase] : tritbl[tphase];
     return ret;
@@ -254,7 +340,11 @@ namespace xgm
 
     counter[1] -= clocks;
     assert (nfreq > 0); // prevent infinite loop
-    while (counter[1] < 0)
+
+    // step singly while the register holds bits above the 15-bit sequence
+    // (randomized at reset) or has no tap selected yet
+    bool sequence = (noise_tap == (1<<1) || noise_tap == (1<<6));
+    while (counter[1] < 0 && (noise > 0x7FFF || !sequence))
     {
         // tick the noise generator
         UINT32 feedback = (noise&1) ^ ((noise&noise_tap)?1:0);
@@ -267,6 +357,19 @@ namespace xgm
         accum_clocks += nfreq;
     }
 
+    // otherwise advance through all remaining periods at once
+    if (counter[1] < 0)
+    {
+        UINT32 steps = (UINT32(-counter[1]) + nfreq - 1) / nfreq;
+        UINT32 zeros = NoiseSequence::Get(noise_tap).Advance(noise, steps);
+
+        last = (noise & 0x4000) ? 0 : env;
+        accum += env * nfreq * zeros;
+        counter[1] += INT32(steps * nfreq);
+        count += steps;
+        accum_clocks += steps * nfreq;
+    }
+
     if (count < 1) // no change over interval, don't anti-alias
     {
        return last;
@@ -283,6 +386,30 @@ namespace xgm
     return average;
   }
 
+  // calc_noise without the anti-aliasing, for when the output is not used
+  void NES_DMC::step_noise(UINT32 clocks)
+  {
+    if (clocks < 1) return;
+
+    counter[1] -= clocks;
+    assert (nfreq > 0); // prevent infinite loop
+
+    bool sequence = (noise_tap == (1<<1) || noise_tap == (1<<6));
+    while (counter[1] < 0 && (noise > 0x7FFF || !sequence))
+    {
+        UINT32 feedback = (noise&1) ^ ((noise&noise_tap)?1:0);
+        noise = (noise>>1) | (feedback<<14);
+        counter[1] += nfreq;
+    }
+
+    if (counter[1] < 0)
+    {
+        UINT32 steps = (UINT32(-counter[1]) + nfreq - 1) / nfreq;
+        NoiseSequence::Get(noise_tap).Advance(noise, steps);
+        counter[1] += INT32(steps * nfreq);
+    }
+  }
+
 	// Tick the DMC for the number of clocks, and return output counter;
 	UINT32 NES_DMC::calc_dmc (UINT32 clocks)
 	{
@@ -362,6 +489,14 @@ namespace xgm
     out[2] = calc_dmc(clocks);
   }
 
+  // the DMC still has to fetch its samples and raise its IRQ
+  void NES_DMC::TickState (UINT32 clocks)
+  {
+    calc_tri(clocks);
+    step_noise(clocks);
+    calc_dmc(clocks);
+  }
+
   UINT32 NES_DMC::Render (INT32 b[2])
   {
     out[0] = (mask & 1) ? 0 : out[0];
@@ -369,24 +504,18 @@ namespace xgm
     out[2] = (mask & 4) ? 0 : out[2];
 
     INT32 m[3];
-    m[0] = tnd_table[0][out[0]][0][0];
-    m[1] = tnd_table[0][0][out[1]][0];
-    m[2] = tnd_table[0][0][0][out[2]];
-
     if (option[OPT_NONLINEAR_MIXER])
     {
-        INT32 ref = m[0] + m[1] + m[2];
-        INT32 voltage = tnd_table[1][out[0]][out[1]][out[2]];
-        if (ref)
-        {
-            for (int i=0; i < 3; ++i)
-                m[i] = (m[i] * voltage) / ref;
-        }
-        else
-        {
-            for (int i=0; i < 3; ++i)
-                m[i] = voltage;
-        }
+        const UINT16* v = tnd_table->m[out[0]][out[1]][out[2]];
+        m[0] = v[0];
+        m[1] = v[1];
+        m[2] = v[2];
+    }
+    else
+    {
+        m[0] = tnd_linear_t[out[0]];
+        m[1] = tnd_linear_n[out[1]];
+        m[2] = tnd_linear_d[out[2]];
     }
 
     // anti-click nullifies any 4011 write but preserves nonlinearity
@@ -448,38 +577,83 @@ namespace xgm
       apu = apu_;
   }
 
+  // volume adjusted by 0.95 based on empirical measurements
+  static const double TND_MASTER = 8192.0 * 0.95;
+  // truthfully, the nonlinear curve does not appear to match well
+  // with my tests. Do more testing of the APU/DMC DAC later.
+  // this value keeps the triangle consistent with measured levels,
+  // but not necessarily the rest of this APU channel,
+  // because of the lack of a good DAC model, currently.
+
+  // Linear mixer, separable so one table per channel
+  static void BuildTNDLinear(UINT32 lt[16], UINT32 ln[16], UINT32 ld[128])
+  {
+    for(int t=0; t<16 ; t++)
+      lt[t] = (UINT32)(TND_MASTER*(3.0*t)/208.0);
+    for(int n=0; n<16; n++)
+      ln[n] = (UINT32)(TND_MASTER*(2.0*n)/208.0);
+    for(int d=0; d<128; d++)
+      ld[d] = (UINT32)(TND_MASTER*(double)d/208.0);
+  }
+
   // Initializing TRI, NOISE, DPCM mixing table
   void NES_DMC::InitializeTNDTable(double wt, double wn, double wd) {
 
-    // volume adjusted by 0.95 based on empirical measurements
-    const double MASTER = 8192.0 * 0.95;
-    // truthfully, the nonlinear curve does not appear to match well
-    // with my tests. Do more testing of the APU/DMC DAC later.
-    // this value keeps the triangle consistent with measured levels,
-    // but not necessarily the rest of this APU channel,
-    // because of the lack of a good DAC model, currently.
-
     { // Linear Mixer
-      for(int t=0; t<16 ; t++) {
-        for(int n=0; n<16; n++) {
-          for(int d=0; d<128; d++) {
-              tnd_table[0][t][n][d] = (UINT32)(MASTER*(3.0*t+2.0*n+d)/208.0);
-          }
-        }
-      }
+      BuildTNDLinear(tnd_linear_t, tnd_linear_n, tnd_linear_d);
     }
     { // Non-Linear Mixer
-      tnd_table[1][0][0][0] = 0;
-      for(int t=0; t<16 ; t++) {
-        for(int n=0; n<16; n++) {
-          for(int d=0; d<128; d++) {
-            if(t!=0||n!=0||d!=0)
-              tnd_table[1][t][n][d] = (UINT32)((MASTER*159.79)/(100.0+1.0/((double)t/wt+(double)n/wn+(double)d/wd)));
-          }
+      tnd_table = GetTNDTable(wt, wn, wd);
+    }
+
+  }
+
+  // The nonlinear table is 256k and depends only on the weights, so it is
+  // built once per set of weights on first use and shared read-only by
+  // every instance (kept until exit). The default weights take a static
+  // (thread-safe initialization) so constructing players never locks.
+  static NES_DMC::TNDTable* BuildTNDTable(double wt, double wn, double wd)
+  {
+    UINT32 lt[16], ln[16], ld[128];
+    BuildTNDLinear(lt, ln, ld);
+
+    NES_DMC::TNDTable* table = new NES_DMC::TNDTable;
+    for(int t=0; t<16 ; t++) {
+      for(int n=0; n<16; n++) {
+        for(int d=0; d<128; d++) {
+          INT32 voltage = 0;
+          if(t!=0||n!=0||d!=0)
+            voltage = (UINT32)((TND_MASTER*159.79)/(100.0+1.0/((double)t/wt+(double)n/wn+(double)d/wd)));
+
+          // split in proportion to the linear levels, so Render needs no division
+          INT32 m[3] = { INT32(lt[t]), INT32(ln[n]), INT32(ld[d]) };
+          INT32 ref = m[0] + m[1] + m[2];
+          UINT16* v = table->m[t][n][d];
+          for (int i=0; i < 3; ++i)
+            v[i] = UINT16(ref ? (m[i] * voltage) / ref : voltage);
+          v[3] = UINT16(voltage);
         }
       }
     }
+    return table;
+  }
+
+  const NES_DMC::TNDTable* NES_DMC::GetTNDTable(double wt, double wn, double wd)
+  {
+    if(wt==TND_WT && wn==TND_WN && wd==TND_WD)
+    {
+      static const std::unique_ptr<TNDTable> standard(BuildTNDTable(TND_WT, TND_WN, TND_WD));
+      return standard.get();
+    }
+
+    static std::mutex lock;
+    static std::map< std::tuple<double,double,double>, std::unique_ptr<TNDTable> > tables;
 
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<TNDTable>& table = tables[std::make_tuple(wt, wn, wd)];
+    if (!table)
+      table.reset(BuildTNDTable(wt, wn, wd));
+    return table.get();
   }
 
   void NES_DMC::Reset ()
@@ -487,12 +661,13 @@ namespace xgm
     int i;
     mask = 0;
 
-    InitializeTNDTable(8227,12241,22638);
+    InitializeTNDTable(TND_WT,TND_WN,TND_WD);
 
     counter[0] = 0;
     counter[1] = 0;
     counter[2] = 0;
     tphase = 0;
+    NoDividerSteps(tsteps);
     nfreq = wavlen_table[0][0];
     dfreq = freq_table[0][0];
     tri_freq = 0;
@@ -570,7 +745,7 @@ namespace xgm
     {
       option[id] = val;
       if(id==OPT_NONLINEAR_MIXER)
-        InitializeTNDTable(8227,12241,22638);
+        InitializeTNDTable(TND_WT,TND_WN,TND_WD);
     }
   }
 
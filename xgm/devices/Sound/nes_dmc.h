@@ -4,6 +4,7 @@
 #include "../device.h"
 #include "../Audio/MedianFilter.h"
 #include "../CPU/nes_cpu.h"
+#include "divider.h"
 
 namespace xgm
 {
@@ -26,11 +27,23 @@ namespace xgm
       OPT_DPCM_REVERSE,
       OPT_END 
     };
+
+    // nonlinear TND mixing table for one set of weights:
+    // m[t][n][d] holds the voltage split between triangle, noise and DMC
+    // in proportion to their linear levels, then the total voltage
+    struct TNDTable
+    {
+      UINT16 m[16][16][128][4];
+    };
+
   protected:
     const int GETA_BITS;
     static const UINT32 freq_table[2][16];
     static const UINT32 wavlen_table[2][16];
-    UINT32 tnd_table[2][16][16][128];
+    UINT32 tnd_linear_t[16];   // linear mixer, one table per channel
+    UINT32 tnd_linear_n[16];
+    UINT32 tnd_linear_d[128];
+    const TNDTable* tnd_table; // nonlinear mixer, shared (see GetTNDTable)
 
     int option[OPT_END];
     int mask;
@@ -57,6 +70,7 @@ namespace xgm
 
     INT32 counter[3];  // frequency dividers
     int tphase;        // triangle phase
+    DividerSteps tsteps; // triangle phase steps of the last Tick
     UINT32 nfreq;      // noise frequency
     UINT32 dfreq;      // DPCM frequency
 
@@ -98,12 +112,14 @@ namespace xgm
     inline UINT32 calc_tri (UINT32 clocks);
     inline UINT32 calc_dmc (UINT32 clocks);
     inline UINT32 calc_noise (UINT32 clocks);
+    inline void step_noise (UINT32 clocks);
 
   public:
       NES_DMC ();
      ~NES_DMC ();
 
     void InitializeTNDTable(double wt, double wn, double wd);
+    static const TNDTable* GetTNDTable(double wt, double wn, double wd);
     void SetPal (bool is_pal);
     void SetAPU (NES_APU* apu_);
     void SetMemory (IDevice * r);
@@ -113,6 +129,7 @@ namespace xgm
 
     virtual void Reset ();
     virtual void Tick (UINT32 clocks);
+    virtual void TickState (UINT32 clocks);
     virtual UINT32 Render (INT32 b[2]);
     virtual bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
     virtual bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
@@ -124,6 +141,9 @@ namespace xgm
     virtual void SetStereoMix (int trk, xgm::INT16 mixl, xgm::INT16 mixr);
     virtual ITrackInfo *GetTrackInfo(int trk);
 
+    // phase steps of the triangle during the last Tick
+    const DividerSteps & GetTriangleSteps() const { return tsteps; }
+
     void SetCPU(NES_CPU* cpu_);
   };
 
@@ -124,105 +124,167 @@ void NES_FDS::Reset ()
     Write(0x4086, 0x00); // mod freq 0
     Write(0x4087, 0x80); // mod disable
     Write(0x4089, 0x00); // wav write disable, max global volume}
+
+    update_mod_table();
 }
 
-void NES_FDS::Tick (UINT32 clocks)
+// position change of each mod table value (4 resets the position instead)
+static const INT32 MOD_BIAS[8] = { 0, 1, 2, 4, 0, -4, -2, -1 };
+
+void NES_FDS::update_mod_table ()
 {
-    // clock envelopes
-    if (!env_halt && !wav_halt && (master_env_speed != 0))
+    mod_sum[0] = 0;
+    INT32 last = -1;
+    for (int i=0; i<128; ++i)
     {
-        for (int i=0; i<2; ++i)
-        {
-            if (!env_disable[i])
-            {
-                env_timer[i] += clocks;
-                UINT32 period = ((env_speed[i]+1) * master_env_speed) << 3;
-                while (env_timer[i] >= period)
-                {
-                    // clock the envelope
-                    if (env_mode[i])
-                    {
-                        if (env_out[i] < 32) ++env_out[i];
-                    }
-                    else
-                    {
-                        if (env_out[i] > 0 ) --env_out[i];
-                    }
-                    env_timer[i] -= period;
-                }
-            }
-        }
+        INT32 wv = wave[TMOD][i & 0x3F];
+        if (wv == 4) last = i;
+        mod_reset[i] = last;
+        mod_sum[i+1] = mod_sum[i] + ((wv == 4) ? 0 : MOD_BIAS[wv]);
     }
+}
+
+// applies count mod table steps starting at table position pos
+void NES_FDS::step_mod (UINT32 pos, UINT64 count)
+{
+    if (count == 0) return;
 
-    // clock the mod table
-    if (!mod_halt)
+    // the last step taken, in the second copy of the table
+    UINT32 e = ((pos + UINT32((count - 1) & 0x3F)) & 0x3F) + 64;
+    INT32 r = mod_reset[e];
+    if (r >= 0 && UINT64(e - r) < count) // reset on the way, sum the steps after it
     {
-        // advance phase, adjust for modulator
-        UINT32 start_pos = phase[TMOD] >> 16;
-        phase[TMOD] += (clocks * freq[TMOD]);
-        UINT32 end_pos = phase[TMOD] >> 16;
+        mod_pos = UINT32(mod_sum[e+1] - mod_sum[r+1]) & 0x7F;
+        return;
+    }
+    UINT32 rem = UINT32(count & 0x3F);
+    UINT32 full = UINT32((count >> 6) & 0x7F); // only the 7-bit sum matters
+    INT32 sum = INT32(full) * mod_sum[64] + (mod_sum[e+1] - mod_sum[e+1-rem]);
+    mod_pos = (mod_pos + UINT32(sum)) & 0x7F;
+}
 
-        // wrap the phase to the 64-step table (+ 16 bit accumulator)
-        phase[TMOD] = phase[TMOD] & 0x3FFFFF;
+void NES_FDS::clock_mod (UINT32 clocks)
+{
+    UINT32 start_pos = phase[TMOD] >> 16;
+    UINT64 p = UINT64(phase[TMOD]) + UINT64(clocks) * freq[TMOD];
+    step_mod(start_pos & 0x3F, (p >> 16) - start_pos);
+    phase[TMOD] = UINT32(p) & 0x3FFFFF; // wrap the phase to the 64-step table (+ 16 bit accumulator)
+}
 
-        // execute all clocked steps
-        for (UINT32 p = start_pos; p < end_pos; ++p)
-        {
-            INT32 wv = wave[TMOD][p & 0x3F];
-            if (wv == 4) // 4 resets mod position
-                mod_pos = 0;
-            else
-            {
-                const INT32 BIAS[8] = { 0, 1, 2, 4, 0, -4, -2, -1 };
-                mod_pos += BIAS[wv];
-                mod_pos &= 0x7F; // 7-bit clamp
-            }
-        }
+void NES_FDS::clock_env (int i, UINT32 clocks)
+{
+    env_timer[i] += clocks;
+    UINT32 period = env_period(i);
+    if (env_timer[i] < period) return;
+
+    UINT32 n = env_timer[i] / period;
+    env_timer[i] -= n * period;
+    if (env_mode[i])
+    {
+        if (env_out[i] < 32) env_out[i] = (n < 32 - env_out[i]) ? (env_out[i] + n) : 32;
+    }
+    else
+    {
+        env_out[i] = (n < env_out[i]) ? (env_out[i] - n) : 0;
     }
+}
 
-    // clock the wav table
-    if (!wav_halt)
+// wave frequency adjusted by the modulator
+INT32 NES_FDS::calc_freq () const
+{
+    if (env_out[EMOD] == 0) // skip if modulator off
+        return freq[TWAV];
+
+    // convert mod_pos to 7-bit signed
+    INT32 pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
+
+    // multiply pos by gain,
+    // shift off 4 bits but with odd "rounding" behaviour
+    INT32 temp = pos * env_out[EMOD];
+    INT32 rem = temp & 0x0F;
+    temp >>= 4;
+    if ((rem > 0) && ((temp & 0x80) == 0))
     {
-        // complex mod calculation
-        INT32 mod = 0;
-        if (env_out[EMOD] != 0) // skip if modulator off
+        if (pos < 0) temp -= 1;
+        else         temp += 2;
+    }
+
+    // wrap if range is exceeded
+    while (temp >= 192) temp -= 256;
+    while (temp <  -64) temp += 256;
+
+    // multiply result by pitch,
+    // shift off 6 bits, round to nearest
+    temp = freq[TWAV] * temp;
+    rem = temp & 0x3F;
+    temp >>= 6;
+    if (rem >= 32) temp += 1;
+
+    return freq[TWAV] + temp;
+}
+
+// The batch is split wherever a mod table step or a mod envelope step
+// can change the wave frequency, and such a step takes effect on the
+// clock it happens, so the result does not depend on how the clocks
+// are divided between calls.
+void NES_FDS::advance (UINT32 clocks)
+{
+    bool env_run = !env_halt && !wav_halt && (master_env_speed != 0);
+
+    // the volume envelope only matters for the final output
+    if (env_run && !env_disable[EVOL])
+        clock_env(EVOL, clocks);
+
+    if (wav_halt)
+    {
+        // the wave frequency is not used, nothing to split
+        if (!mod_halt)
+            clock_mod(clocks);
+    }
+    else
+    {
+        bool emod_run = env_run && !env_disable[EMOD];
+        INT32 f = calc_freq();
+        while (clocks)
         {
-            // convert mod_pos to 7-bit signed
-            INT32 pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
-
-            // multiply pos by gain,
-            // shift off 4 bits but with odd "rounding" behaviour
-            INT32 temp = pos * env_out[EMOD];
-            INT32 rem = temp & 0x0F;
-            temp >>= 4;
-            if ((rem > 0) && ((temp & 0x80) == 0))
+            UINT32 seg = clocks;
+
+            bool emod_live = emod_run &&
+                (env_mode[EMOD] ? (env_out[EMOD] < 32) : (env_out[EMOD] > 0));
+            if (emod_live)
+            {
+                UINT32 period = env_period(EMOD);
+                UINT32 next = (env_timer[EMOD] < period) ? (period - env_timer[EMOD]) : 1;
+                if (next < seg) seg = next;
+            }
+
+            if (!mod_halt && freq[TMOD] != 0 && (emod_live || env_out[EMOD] != 0))
             {
-                if (pos < 0) temp -= 1;
-                else         temp += 2;
+                UINT32 next = (0x10000 - (phase[TMOD] & 0xFFFF) + freq[TMOD] - 1) / freq[TMOD];
+                if (next < seg) seg = next;
             }
 
-            // wrap if range is exceeded
-            while (temp >= 192) temp -= 256;
-            while (temp <  -64) temp += 256;
+            // all but the last clock run at the current frequency
+            phase[TWAV] = phase[TWAV] + ((seg - 1) * f);
 
-            // multiply result by pitch,
-            // shift off 6 bits, round to nearest
-            temp = freq[TWAV] * temp;
-            rem = temp & 0x3F;
-            temp >>= 6;
-            if (rem >= 32) temp += 1;
+            if (emod_run)
+                clock_env(EMOD, seg);
+            if (!mod_halt)
+                clock_mod(seg);
 
-            mod = temp;
+            f = calc_freq();
+            phase[TWAV] = (phase[TWAV] + f) & 0x3FFFFF; // wrap
+            clocks -= seg;
         }
 
-        // advance wavetable position
-        INT32 f = freq[TWAV] + mod;
-        phase[TWAV] = phase[TWAV] + (clocks * f);
-        phase[TWAV] = phase[TWAV] & 0x3FFFFF; // wrap
-
         // store for trackinfo
         last_freq = f;
     }
+}
+
+void NES_FDS::Tick (UINT32 clocks)
+{
+    advance (clocks);
 
     // output volume caps at 32
     INT32 vol_out = env_out[EVOL];
@@ -242,6 +304,11 @@ void NES_FDS::Tick (UINT32 clocks)
     last_vol = vol_out;
 }
 
+void NES_FDS::TickState (UINT32 clocks)
+{
+    advance (clocks);
+}
+
 UINT32 NES_FDS::Render (INT32 b[2])
 {
     // 8 bit approximation of master volume
@@ -348,6 +415,7 @@ bool NES_FDS::Write (UINT32 adr, UINT32 val, UINT32 id)
             wave[TMOD][(phase[TMOD] >> 16) & 0x3F] = val & 0x07;
             phase[TMOD] = (phase[TMOD] + 0x010000) & 0x3FFFFF;
             mod_write_pos = phase[TMOD] >> 16; // used by OPT_4085_RESET
+            update_mod_table();
         }
         return true;
     case 0x89: // $4089 wave write enable, master volume
@@ -47,6 +47,10 @@ protected:
     UINT32 mod_pos;
     UINT32 mod_write_pos;
 
+    // mod table over two periods, accumulated for step_mod
+    INT32 mod_sum[129];   // sum of the position changes of steps 0..i-1
+    INT32 mod_reset[128]; // last step <= i that resets the position, -1 if none
+
     // two ramp envelopes
     enum { EMOD=0, EVOL=1 };
     bool env_mode[2];
@@ -63,12 +67,21 @@ protected:
     INT32 rc_k;
     INT32 rc_l;
 
+    UINT32 env_period (int i) const { return ((env_speed[i]+1) * master_env_speed) << 3; }
+    void clock_env (int i, UINT32 clocks);
+    void update_mod_table ();
+    void step_mod (UINT32 pos, UINT64 count);
+    void clock_mod (UINT32 clocks);
+    INT32 calc_freq () const;
+    void advance (UINT32 clocks);
+
 public:
     NES_FDS ();
     virtual ~ NES_FDS ();
 
     virtual void Reset ();
     virtual void Tick (UINT32 clocks);
+    virtual void TickState (UINT32 clocks);
     virtual UINT32 Render (INT32 b[2]);
     virtual bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
     virtual bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
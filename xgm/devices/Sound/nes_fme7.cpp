@@ -1,186 +1,521 @@
 #include "nes_fme7.h"
 
-using namespace xgm;
+namespace xgm
+{
+  // YM2149 volume curve, 32 steps (4-bit volume registers use every second one)
+  static const INT32 voltbl[32] = {
+    0x00, 0x01, 0x01, 0x02, 0x02, 0x03, 0x03, 0x04, 0x05, 0x06, 0x07, 0x09,
+    0x0B, 0x0D, 0x0F, 0x12,
+    0x16, 0x1A, 0x1F, 0x25, 0x2D, 0x35, 0x3F, 0x4C, 0x5A, 0x6A, 0x7F, 0x97,
+    0xB4, 0xD6, 0xEB, 0xFF
+  };
 
-const int DIVIDER = 8; // TODO this is not optimal, rewrite PSG output
+  // The noise LFSR is linear over GF(2), so n steps are a 17x17 bit matrix.
+  // col[k][b] is bit b of the state advanced by 2^k steps; any count of
+  // steps is then at most 32 matrix applications.
+  // Built on first use, immutable afterwards.
+  class NoiseJump
+  {
+  protected:
+    UINT32 col[32][17];
 
-NES_FME7::NES_FME7 ()
-{
-  psg = PSG_new ((e_uint32)DEFAULT_CLOCK, DEFAULT_RATE);
-  divider = 0;
+    static UINT32 Apply(const UINT32 c[17], UINT32 state)
+    {
+      UINT32 r = 0;
+      for (int b = 0; state; ++b, state >>= 1)
+        if (state & 1) r ^= c[b];
+      return r;
+    }
 
-  for(int c=0;c<2;++c)
-    for(int t=0;t<3;++t)
-      sm[c][t] = 128;
-}
+  public:
+    NoiseJump()
+    {
+      for (int b = 0; b < 17; ++b)
+        col[0][b] = b ? (1u << (b-1)) : 0x12000;
+      for (int k = 1; k < 32; ++k)
+        for (int b = 0; b < 17; ++b)
+          col[k][b] = Apply(col[k-1], col[k-1][b]);
+    }
 
-NES_FME7::~NES_FME7 ()
-{
-  if (psg)
-    PSG_delete (psg);
-}
+    UINT32 Advance(UINT32 state, UINT32 steps) const
+    {
+      for (int k = 0; steps; ++k, steps >>= 1)
+        if (steps & 1) state = Apply(col[k], state);
+      return state;
+    }
 
-void NES_FME7::SetClock (double c)
-{
-  this->clock = c * 2.0;
-}
+    static const NoiseJump& Get()
+    {
+      static const NoiseJump jump;
+      return jump;
+    }
+  };
 
-void NES_FME7::SetRate (double r)
-{
-  //rate = r ? r : DEFAULT_RATE;
-  rate = DEFAULT_CLOCK / double(DIVIDER); // TODO rewrite PSG to integrate with clock
-  if (psg)
-    PSG_set_rate (psg, (e_uint32)rate);
-}
+  NES_FME7::NES_FME7 ()
+  {
+    SetClock (DEFAULT_CLOCK);
+    SetRate (DEFAULT_RATE);
+    mask = 0;
 
-void NES_FME7::SetOption (int id, int val)
-{
-  if(id<OPT_END)
+    for(int c=0;c<2;++c)
+      for(int t=0;t<3;++t)
+        sm[c][t] = 128;
+    Reset();
+  }
+
+  NES_FME7::~NES_FME7 ()
   {
-    //option[id] = val;
   }
-}
 
-void NES_FME7::Reset ()
-{
-  for (int i=0; i<16; ++i) // blank all registers
+  void NES_FME7::SetClock (double c)
   {
-    Write(0xC000,i);
-    Write(0xE000,0);
+    clock = c;
   }
-  Write(0xC000,0x07); // disable all tones
-  Write(0xE000,0x3F);
 
-  divider = 0;
-  if (psg)
-    PSG_reset (psg);
-}
+  void NES_FME7::SetRate (double r)
+  {
+    rate = r ? r : DEFAULT_RATE;
+  }
 
-bool NES_FME7::Write (xgm::UINT32 adr, xgm::UINT32 val, xgm::UINT32 id)
-{
-  if (adr == 0xC000)
+  void NES_FME7::SetOption (int id, int val)
   {
-    if (psg)
-      PSG_writeIO (psg, 0, val);
-    return true;
+    if(id<OPT_END)
+    {
+      //option[id] = val;
+    }
   }
-  if (adr == 0xE000)
+
+  void NES_FME7::Reset ()
   {
-    if (psg)
-      PSG_writeIO (psg, 1, val);
-    return true;
+    select = 0;
+    for (int i=0; i<16; ++i) // blank all registers
+      reg[i] = 0;
+    reg[0x07] = 0x3F; // disable all tones
+
+    for (int i=0; i<3; ++i)
+    {
+      freq[i] = 0;
+      count[i] = 0x1000;
+      edge[i] = 0;
+      volume[i] = 0;
+      tmask[i] = 1;
+      nmask[i] = 1;
+      out[i] = 0;
+    }
+
+    noise_seed = 0xFFFF;
+    noise_count = 0x40;
+    noise_freq = 0;
+
+    env_ptr = 0;
+    env_face = 0;
+    env_continue = 0;
+    env_attack = 0;
+    env_alternate = 0;
+    env_hold = 0;
+    env_pause = 1;
+    env_freq = 0;
+    env_count = 0;
+
+    divider = 0;
+  }
+
+  void NES_FME7::WriteReg (UINT32 r, UINT32 val)
+  {
+    if (r > 15) return;
+
+    reg[r] = UINT8(val & 0xFF);
+    switch (r)
+    {
+    case 0: case 1:
+    case 2: case 3:
+    case 4: case 5:
+      {
+        int c = r >> 1;
+        freq[c] = ((reg[c * 2 + 1] & 15) << 8) + reg[c * 2];
+      }
+      break;
+
+    case 6:
+      noise_freq = (val == 0) ? 1 : ((val & 31) << 1);
+      break;
+
+    case 7:
+      tmask[0] = (val & 1);
+      tmask[1] = (val & 2);
+      tmask[2] = (val & 4);
+      nmask[0] = (val & 8);
+      nmask[1] = (val & 16);
+      nmask[2] = (val & 32);
+      break;
+
+    case 8: case 9: case 10:
+      volume[r - 8] = val & 31;
+      break;
+
+    case 11: case 12:
+      env_freq = (reg[12] << 8) + reg[11];
+      break;
+
+    case 13:
+      env_continue = (val >> 3) & 1;
+      env_attack = (val >> 2) & 1;
+      env_alternate = (val >> 1) & 1;
+      env_hold = val & 1;
+      env_face = env_attack;
+      env_pause = 0;
+      env_count = 0x10000 - env_freq;
+      env_ptr = env_face ? 0 : 0x1F;
+      break;
+
+    default:
+      break;
+    }
   }
-  else
+
+  bool NES_FME7::Write (UINT32 adr, UINT32 val, UINT32 id)
+  {
+    if (adr == 0xC000)
+    {
+      select = val & 0x1F;
+      return true;
+    }
+    if (adr == 0xE000)
+    {
+      WriteReg (select, val);
+      return true;
+    }
+    else
+      return false;
+  }
+
+  bool NES_FME7::Read (UINT32 adr, UINT32 & val, UINT32 id)
+  {
     return false;
-}
+  }
 
-bool NES_FME7::Read (xgm::UINT32 adr, xgm::UINT32 & val, xgm::UINT32 id)
-{
-  // not sure why this was here - BS
-  //if (psg)
-  //  val = PSG_readIO (psg);
+  // The PSG is updated every 8 clocks and its counters advance on every
+  // second update (one step per 16 clocks). An update tests the counter
+  // whether or not it advanced, which matters only while a counter is past
+  // its edge (after reset or a period change); those updates are done
+  // singly, the rest in closed form over the steps.
+  static inline UINT32 StepsIn (UINT32 updates, bool idle_first)
+  {
+    return idle_first ? (updates / 2) : ((updates + 1) / 2);
+  }
 
-  return false;
-}
+  // Whenever bit 12 of the counter is set the edge toggles and the period
+  // is subtracted. Only bit 12 is observable, so the counter wraps at 13 bits.
+  inline void NES_FME7::calc_tone (int i, UINT32 updates, bool idle_first)
+  {
+    UINT32 c = count[i];
+    UINT32 f = freq[i];
 
-void NES_FME7::Tick (xgm::UINT32 clocks)
-{
-  divider += clocks;
-  while (divider >= DIVIDER)
+    if (c < 0x1000 && f > 1) // usual case, not reaching the edge
+    {
+      UINT32 steps = StepsIn(updates, idle_first);
+      if (steps < 0x1000 - c)
+      {
+        count[i] = c + steps;
+        return;
+      }
+    }
+
+    if (f <= 1) // the edge is held high while bit 12 is set
+    {
+      UINT32 steps = StepsIn(updates, idle_first);
+      if ((idle_first && (c & 0x1000)) || steps >= 0x1000 ||
+          (steps && (((c + 1) & 0x1000) || ((c + steps) & 0x1000))))
+        edge[i] = 1;
+      count[i] = (c + steps) & 0x1FFF;
+      return;
+    }
+
+    while (updates && (c & 0x1000))
+    {
+      if (!idle_first) c = (c + 1) & 0x1FFF;
+      idle_first = !idle_first;
+      --updates;
+      if (c & 0x1000)
+      {
+        edge[i] ^= 1;
+        c = (c - f) & 0x1FFF;
+      }
+    }
+
+    // otherwise count up to 0x1000, then every f steps
+    UINT32 steps = StepsIn(updates, idle_first);
+    UINT32 first = 0x1000 - c;
+    if (c & 0x1000 || steps < first)
+      c += steps;
+    else
+    {
+      steps -= first;
+      edge[i] ^= (1 + steps / f) & 1;
+      c = 0x1000 - f + steps % f;
+    }
+    count[i] = c;
+  }
+
+  // Same scheme as the tone with a 7-bit counter and bit 6, stepping the
+  // LFSR instead of toggling.
+  inline void NES_FME7::calc_noise (UINT32 updates, bool idle_first)
   {
-      divider -= DIVIDER;
-      if (psg) PSG_calc(psg);
+    UINT32 c = noise_count;
+    UINT32 f = noise_freq;
+    UINT32 n = 0; // LFSR steps
+
+    if (c < 0x40) // usual case, not reaching the edge
+    {
+      UINT32 steps = StepsIn(updates, idle_first);
+      if (steps < 0x40 - c)
+      {
+        noise_count = c + steps;
+        return;
+      }
+    }
+
+    while (updates)
+    {
+      if (c & 0x40) // past the edge
+      {
+        if (f == 0) // steps on every update until the counter wraps to 0
+        {
+          UINT32 k = 0x80 - c;
+          UINT32 at = idle_first ? 2*k : 2*k - 1;
+          if (updates < at)
+          {
+            n += updates;
+            c += StepsIn(updates, idle_first);
+            break;
+          }
+          n += at - 1;
+          updates -= at;
+          c = 0;
+          idle_first = true;
+          // from here it repeats every 256 updates, stepping on 128
+          n += (updates / 256) * 128;
+          updates %= 256;
+          continue;
+        }
+        if (!idle_first) c = (c + 1) & 0x7F;
+        idle_first = !idle_first;
+        --updates;
+        if (c & 0x40)
+        {
+          ++n;
+          c = (c - f) & 0x7F;
+        }
+        continue;
+      }
+
+      UINT32 steps = StepsIn(updates, idle_first);
+      UINT32 first = 0x40 - c;
+      if (steps < first)
+      {
+        c += steps;
+        break;
+      }
+      ++n;
+      if (f == 0) // stays past the edge
+      {
+        updates -= idle_first ? 2*first : 2*first - 1;
+        idle_first = true;
+        c = 0x40;
+        continue;
+      }
+      steps -= first;
+      n += steps / f;
+      c = 0x40 - f + steps % f;
+      break;
+    }
+    noise_count = c;
+
+    if (n < 32)
+    {
+      for (; n; --n)
+      {
+        if (noise_seed & 1)
+          noise_seed ^= 0x24000;
+        noise_seed >>= 1;
+      }
+    }
+    else
+      noise_seed = NoiseJump::Get().Advance(noise_seed, n);
   }
-}
 
-xgm::UINT32 NES_FME7::Render (xgm::INT32 b[2])
-{
-  b[0] = b[1] = 0;
+  // The envelope steps once every env_freq steps after its counter passes
+  // 0x10000 (a period of 0 stops it, the counter keeps running).
+  inline void NES_FME7::calc_envelope (UINT32 steps)
+  {
+    UINT32 total = env_count + steps;
+    if (env_freq == 0 || total < 0x10000)
+    {
+      env_count = total;
+      return;
+    }
+    UINT32 n = (total - 0x10000) / env_freq + 1;
+    env_count = total - n * env_freq;
+    step_envelope (n);
+  }
+
+  void NES_FME7::step_envelope (UINT32 n)
+  {
+    while (n && !env_pause)
+    {
+      // steps until the pointer carries (attack) or borrows (decay)
+      UINT32 r = env_face ? (0x20 - env_ptr) : (env_ptr + 1);
+      if (n < r)
+      {
+        env_ptr = env_face ? (env_ptr + n) : (env_ptr - n);
+        return;
+      }
+      n -= r;
+
+      if (!env_continue)
+      {
+        env_pause = 1;
+        env_ptr = 0;
+        return;
+      }
+      if (env_alternate ^ env_hold) env_face ^= 1;
+      if (env_hold) env_pause = 1;
+      env_ptr = env_face ? 0 : 0x1F;
+      if (env_pause) return;
+
+      // repeating: a carry or borrow every 32 steps from here
+      if (env_alternate) env_face ^= (n / 32) & 1;
+      env_ptr = env_face ? 0 : 0x1F;
+      n %= 32;
+    }
+  }
 
-  for (int i=0; i < 3; ++i)
+  inline void NES_FME7::update_output ()
   {
-    // note negative polarity
-    b[0] -= psg->cout[i] * sm[0][i];
-    b[1] -= psg->cout[i] * sm[1][i];
+    UINT32 noise = noise_seed & 1;
+    for (int i = 0; i < 3; ++i)
+    {
+      out[i] = 0;
+      if (mask & (1 << i))
+        continue;
+      if ((tmask[i] || edge[i]) && (nmask[i] || noise))
+        out[i] = (volume[i] & 16) ? voltbl[env_ptr] : voltbl[(volume[i] & 15) << 1];
+    }
   }
-  b[0] >>= (7-4);
-  b[1] >>= (7-4);
 
-  // master volume adjustment
-  const INT32 MASTER = INT32(0.64 * 256.0);
-  b[0] = (b[0] * MASTER) >> 8;
-  b[1] = (b[1] * MASTER) >> 8;
+  // returns false if no update fell within the clocks
+  inline bool NES_FME7::advance (UINT32 clocks)
+  {
+    UINT32 total = divider + clocks;
+    UINT32 updates = (total >> 3) - (divider >> 3);
+    bool idle_first = divider < 8;
+    UINT32 steps = total >> 4;
+    divider = total & 15;
+    if (!updates) return false;
 
-  return 2;
-}
+    calc_envelope (steps);
+    calc_noise (updates, idle_first);
+    for (int i = 0; i < 3; ++i)
+      calc_tone (i, updates, idle_first);
+    return true;
+  }
 
-void NES_FME7::SetStereoMix(int trk, xgm::INT16 mixl, xgm::INT16 mixr)
-{
-      if (trk < 0) return;
-      if (trk > 2) return;
-      sm[0][trk] = mixl;
-      sm[1][trk] = mixr;
-}
+  void NES_FME7::Tick (UINT32 clocks)
+  {
+    if (advance (clocks))
+      update_output ();
+  }
 
-ITrackInfo *NES_FME7::GetTrackInfo(int trk)
-{
-  assert(trk<5);
+  void NES_FME7::TickState (UINT32 clocks)
+  {
+    advance (clocks);
+  }
 
-  if(psg)
+  UINT32 NES_FME7::Render (INT32 b[2])
   {
+    b[0] = b[1] = 0;
+
+    for (int i=0; i < 3; ++i)
+    {
+      // note negative polarity
+      b[0] -= out[i] * sm[0][i];
+      b[1] -= out[i] * sm[1][i];
+    }
+    b[0] >>= (7-4);
+    b[1] >>= (7-4);
+
+    // master volume adjustment
+    const INT32 MASTER = INT32(0.64 * 256.0);
+    b[0] = (b[0] * MASTER) >> 8;
+    b[1] = (b[1] * MASTER) >> 8;
+
+    return 2;
+  }
+
+  void NES_FME7::SetStereoMix(int trk, xgm::INT16 mixl, xgm::INT16 mixr)
+  {
+    if (trk < 0) return;
+    if (trk > 2) return;
+    sm[0][trk] = mixl;
+    sm[1][trk] = mixr;
+  }
+
+  ITrackInfo *NES_FME7::GetTrackInfo(int trk)
+  {
+    assert(trk<5);
+
     if (trk<3)
     {
-      trkinfo[trk]._freq = psg->freq[trk];
-      if(psg->freq[trk])
-        trkinfo[trk].freq = psg->clk/32.0/psg->freq[trk];
+      trkinfo[trk]._freq = freq[trk];
+      if(freq[trk])
+        trkinfo[trk].freq = clock/32.0/freq[trk];
       else
         trkinfo[trk].freq = 0;
 
-      trkinfo[trk].output = psg->cout[trk];
+      trkinfo[trk].output = out[trk];
       trkinfo[trk].max_volume = 15;
-      trkinfo[trk].volume = psg->volume[trk] >> 1;
-      //trkinfo[trk].key = (psg->cout[trk]>0)?true:false;
-      trkinfo[trk].key = !(psg->tmask[trk]);
-      trkinfo[trk].tone = (psg->tmask[trk]?2:0)+(psg->nmask[trk]?1:0);
+      trkinfo[trk].volume = volume[trk] & 15;
+      trkinfo[trk].key = !(tmask[trk]);
+      trkinfo[trk].tone = (tmask[trk]?2:0)+(nmask[trk]?1:0);
     }
     else if (trk == 3) // envelope
     {
-      trkinfo[trk]._freq = psg->env_freq;
-      if(psg->env_freq)
-        trkinfo[trk].freq = psg->clk/512.0/psg->env_freq;
+      trkinfo[trk]._freq = env_freq;
+      if(env_freq)
+        trkinfo[trk].freq = clock/512.0/env_freq;
       else
         trkinfo[trk].freq = 0;
 
-      if (psg->env_continue && psg->env_alternate && !psg->env_hold) // triangle wave
+      if (env_continue && env_alternate && !env_hold) // triangle wave
       {
         trkinfo[trk].freq *= 0.5f; // sounds an octave down
       }
-      
-      trkinfo[trk].output = psg->voltbl[psg->env_ptr];
+
+      trkinfo[trk].output = voltbl[env_ptr];
       trkinfo[trk].max_volume = 0;
       trkinfo[trk].volume = 0;
-      trkinfo[trk].key = (((psg->volume[0]|psg->volume[1]|psg->volume[2])&32) != 0);
+      trkinfo[trk].key = (((volume[0]|volume[1]|volume[2])&16) != 0);
       trkinfo[trk].tone =
-          (psg->env_continue ?8:0) |
-          (psg->env_attack   ?4:0) |
-          (psg->env_alternate?2:0) |
-          (psg->env_hold     ?1:0) ;
+          (env_continue ?8:0) |
+          (env_attack   ?4:0) |
+          (env_alternate?2:0) |
+          (env_hold     ?1:0) ;
     }
     else if (trk == 4) // noise
     {
-      trkinfo[trk]._freq = psg->noise_freq >> 1;
+      trkinfo[trk]._freq = noise_freq >> 1;
       if(trkinfo[trk]._freq > 0)
-        trkinfo[trk].freq = psg->clk/16.0/psg->noise_freq;
+        trkinfo[trk].freq = clock/16.0/noise_freq;
       else
         trkinfo[trk].freq = 0;
 
-      trkinfo[trk].output = psg->noise_seed & 1;
+      trkinfo[trk].output = noise_seed & 1;
       trkinfo[trk].max_volume = 0;
       trkinfo[trk].volume = 0;
-      //trkinfo[trk].key = ((psg->nmask[0]&psg->nmask[1]&psg->nmask[2]) == 0);
       trkinfo[trk].key = false;
       trkinfo[trk].tone = 0;
     }
+    return &trkinfo[trk];
   }
-  return &trkinfo[trk];
-}
+
+}                               // namespace
@@ -1,11 +1,14 @@
 #ifndef _NES_FME7_H_
 #define _NES_FME7_H_
 #include "../device.h"
-#include "legacy/emu2149.h"
 
 namespace xgm
 {
 
+  // Sunsoft 5B (FME-7 with a YM2149-compatible PSG).
+  // The PSG runs on the CPU clock with a fixed /16 prescaler; tone, noise
+  // and envelope periods are counted directly in those steps, so a Tick of
+  // any length costs about the same.
   class NES_FME7:public ISoundChip
   {
   public:
@@ -16,23 +19,61 @@ namespace xgm
   protected:
     //int option[OPT_END];
     INT32 sm[2][3]; // stereo mix
-    INT16 buf[2];
-    PSG *psg;
-    int divider; // clock divider
+    int mask;
     double clock, rate;
     TrackInfoBasic trkinfo[5];
+
+    UINT32 select;   // register address latched at $C000
+    UINT8 reg[16];
+    UINT32 divider;  // CPU clocks into the current PSG step (0..15), updated at 8 and 16
+
+    // tone (count is kept to 13 bits, the edge toggles when bit 12 sets)
+    UINT32 freq[3];
+    UINT32 count[3];
+    UINT32 edge[3];
+    UINT32 volume[3]; // 4-bit volume, bit 4 selects the envelope
+    UINT32 tmask[3];  // tone disabled
+    UINT32 nmask[3];  // noise disabled
+
+    // noise (17-bit LFSR, count is kept to 7 bits, steps when bit 6 sets)
+    UINT32 noise_seed;
+    UINT32 noise_count;
+    UINT32 noise_freq;
+
+    // envelope
+    UINT32 env_ptr;
+    UINT32 env_face;
+    UINT32 env_continue;
+    UINT32 env_attack;
+    UINT32 env_alternate;
+    UINT32 env_hold;
+    UINT32 env_pause;
+    UINT32 env_freq;
+    UINT32 env_count;
+
+    INT32 out[3];
+
+    void WriteReg (UINT32 r, UINT32 val);
+    void calc_tone (int i, UINT32 updates, bool idle_first);
+    void calc_noise (UINT32 updates, bool idle_first);
+    void calc_envelope (UINT32 steps);
+    void step_envelope (UINT32 steps);
+    bool advance (UINT32 clocks);
+    void update_output ();
+
   public:
       NES_FME7 ();
      ~NES_FME7 ();
     virtual void Reset ();
     virtual void Tick (UINT32 clocks);
+    virtual void TickState (UINT32 clocks);
     virtual UINT32 Render (INT32 b[2]);
     virtual bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
     virtual bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
     virtual void SetClock (double);
     virtual void SetRate (double);
     virtual void SetOption (int, int);
-    virtual void SetMask (int m){ if(psg) PSG_setMask(psg,m); }
+    virtual void SetMask (int m){ mask = m; }
     virtual void SetStereoMix (int trk, xgm::INT16 mixl, xgm::INT16 mixr);
     virtual ITrackInfo *GetTrackInfo(int trk);
   };
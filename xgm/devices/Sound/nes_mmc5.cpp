@@ -48,6 +48,8 @@ namespace xgm
     scounter[1] = 0;
     sphase[0] = 0;
     sphase[1] = 0;
+    NoDividerSteps(ssteps[0]);
+    NoDividerSteps(ssteps[1]);
 
     envelope_div[0] = 0;
     envelope_div[1] = 0;
@@ -139,12 +141,8 @@ namespace xgm
       {1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}
     };
 
-    scounter[i] += clocks;
-    while (scounter[i] > freq[i])
-    {
-        sphase[i] = (sphase[i] + 1) & 15;
-        scounter[i] -= (freq[i] + 1);
-    }
+    UINT32 steps = DivideUp(scounter[i], clocks, freq[i], ssteps[i]);
+    sphase[i] = (sphase[i] + steps) & 15;
 
     INT32 ret = 0;
     if (length_counter[i] > 0)
@@ -2,6 +2,7 @@
 #define _NES_MMC5_H_
 #include "../device.h"
 #include "../CPU/nes_cpu.h"
+#include "divider.h"
 
 namespace xgm
 {
@@ -24,6 +25,7 @@ namespace xgm
 
     UINT32 scounter[2];            // frequency divider
     UINT32 sphase[2];              // phase counter
+    DividerSteps ssteps[2];        // phase steps of the last Tick
 
     UINT32 duty[2];
     UINT32 volume[2];
@@ -66,6 +68,9 @@ namespace xgm
     virtual void SetStereoMix (int trk, xgm::INT16 mixl, xgm::INT16 mixr);
     virtual ITrackInfo *GetTrackInfo(int trk);
 
+    // phase steps of square trk during the last Tick
+    const DividerSteps & GetDividerSteps(int trk) const { return ssteps[trk]; }
+
     void SetCPU(NES_CPU* cpu_);
   };
 
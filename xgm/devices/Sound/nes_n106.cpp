@@ -120,6 +120,25 @@ void NES_N106::Reset ()
     Write(0xF800, 0x00); // select $00 without auto-increment
 }
 
+// Advances the phases through a number of 15-clock slots from tick_channel
+// (which must be below channels) without fetching samples. A channel's
+// phase only depends on its own registers, so the order in which the
+// channels are advanced does not matter.
+void NES_N106::skip_slots (int slots, int channels)
+{
+    int rotations = slots / channels;
+    int extra = slots % channels;
+    for (int i = 0; i < channels; ++i)
+    {
+        // slots from tick_channel onward get the partial rotation
+        int steps = rotations + ((((i - tick_channel + channels) % channels) < extra) ? 1 : 0);
+        if (steps > 0)
+            set_phase(advance_phase(7-i, steps), 7-i);
+    }
+    tick_channel = (tick_channel + extra) % channels;
+    tick_clock -= 15 * slots;
+}
+
 void NES_N106::Tick (UINT32 clocks)
 {
     if (master_disable) return;
@@ -128,24 +147,25 @@ void NES_N106::Tick (UINT32 clocks)
 
     tick_clock += clocks;
     render_clock += clocks; // keep render in sync
+
+    // Only the last update of each channel determines its output, so all
+    // but the final rotation of 15-clock slots just advance the phases.
+    if (tick_clock > 0 && tick_channel < channels)
+    {
+        int skip = (tick_clock + 14) / 15 - channels;
+        if (skip > 0)
+            skip_slots (skip, channels);
+    }
+
     while (tick_clock > 0)
     {
         int channel = 7-tick_channel;
 
-        UINT32 phase = get_phase(channel);
-        UINT32 freq  = get_freq(channel);
-        UINT32 len   = get_len(channel);
         UINT32 off   = get_off(channel);
         INT32  vol   = get_vol(channel);
 
-        // accumulate 24-bit phase
-        phase = (phase + freq) & 0x00FFFFFF;
-
-        // wrap phase if wavelength exceeded
-        UINT32 hilen = len << 16;
-        while (phase >= hilen) phase -= hilen;
-
-        // write back phase
+        // accumulate phase and write back
+        UINT32 phase = advance_phase(channel, 1);
         set_phase(phase, channel);
 
         // fetch sample (note: N163 output is centred at 8, and inverted w.r.t 2A03)
@@ -160,6 +180,28 @@ void NES_N106::Tick (UINT32 clocks)
     }
 }
 
+void NES_N106::TickState (UINT32 clocks)
+{
+    if (master_disable) return;
+
+    int channels = get_channels();
+
+    // whole rotations leave the render position where it was, so the
+    // clocks that will not be rendered need not pile up
+    tick_clock += clocks;
+    render_clock = (render_clock + clocks) % (15 * channels);
+
+    if (tick_clock > 0 && tick_channel >= channels) // left from a larger channel count
+    {
+        int channel = 7-tick_channel;
+        set_phase(advance_phase(channel, 1), channel);
+        tick_clock -= 15;
+        tick_channel = 0;
+    }
+    if (tick_clock > 0)
+        skip_slots ((tick_clock + 14) / 15, channels);
+}
+
 UINT32 NES_N106::Render (INT32 b[2])
 {
     b[0] = 0;
@@ -170,27 +212,29 @@ UINT32 NES_N106::Render (INT32 b[2])
 
     if (option[OPT_SERIAL]) // hardware accurate serial multiplexing
     {
-        // this could be made more efficient than going clock-by-clock
-        // but this way is simpler
+        // each channel gets a 15-cycle slice, add up the part of
+        // each slice that falls into this sample
         int clocks = render_clock;
         while (clocks > 0)
         {
             int c = 7-render_channel;
+            int span = 15 - render_subclock;
+            if (span > clocks) span = clocks;
             if (0 == ((mask >> c) & 1))
             {
-                b[0] += fout[c] * sm[0][c];
-                b[1] += fout[c] * sm[1][c];
+                b[0] += fout[c] * sm[0][c] * span;
+                b[1] += fout[c] * sm[1][c] * span;
             }
-            
-            ++render_subclock;
-            if (render_subclock >= 15) // each channel gets a 15-cycle slice
+
+            render_subclock += span;
+            if (render_subclock >= 15)
             {
                 render_subclock = 0;
                 ++render_channel;
                 if (render_channel >= channels)
                     render_channel = 0;
             }
-            --clocks;
+            clocks -= span;
         }
 
         // increase output level by 1 bits (7 bits already added from sm)
@@ -364,4 +408,28 @@ inline void NES_N106::set_phase (UINT32 phase, int channel)
     reg[0x45 + channel] = (phase >> 16) & 0xFF;
 }
 
+inline UINT32 NES_N106::advance_phase (int channel, UINT32 steps)
+{
+    UINT32 phase = get_phase(channel);
+    UINT32 freq  = get_freq(channel);
+    UINT32 hilen = get_len(channel) << 16;
+
+    // accumulate 24-bit phase, wrap phase if wavelength exceeded
+    phase = (phase + freq) & 0x00FFFFFF;
+    if (phase >= hilen) phase %= hilen;
+    if (--steps == 0) return phase;
+
+    // now phase < hilen, so unless phase+freq can overflow the 24-bit
+    // register before wrapping, further steps are plain modular addition
+    if (hilen == 0x01000000 || (hilen - 1 + freq) <= 0x00FFFFFF)
+        return UINT32((phase + UINT64(freq) * steps) % hilen);
+
+    for (; steps > 0; --steps)
+    {
+        phase = (phase + freq) & 0x00FFFFFF;
+        if (phase >= hilen) phase -= hilen;
+    }
+    return phase;
+}
+
 } //namespace
@@ -53,6 +53,9 @@ protected:
     inline int    get_channels ();
     // for storing back the phase after modifying
     inline void   set_phase (UINT32 phase, int channel);
+    // accumulates steps updates of the phase, returns the new phase
+    inline UINT32 advance_phase (int channel, UINT32 steps);
+    void skip_slots (int slots, int channels);
 
 public:
     NES_N106 ();
@@ -60,6 +63,7 @@ public:
 
     virtual void Reset ();
     virtual void Tick (UINT32 clocks);
+    virtual void TickState (UINT32 clocks);
     virtual UINT32 Render (INT32 b[2]);
     virtual bool Write (UINT32 adr, UINT32 val, UINT32 id=0);
     virtual bool Read (UINT32 adr, UINT32 & val, UINT32 id=0);
@@ -92,6 +92,9 @@ namespace xgm
       Write (0xb000 + i, 0);
     }
     count14 = 0;
+    NoDividerSteps(steps[0]);
+    NoDividerSteps(steps[1]);
+    NoDividerSteps(steps[2]);
     mask = 0;
     phase[0] = 0;
     phase[1] = 0;
@@ -112,17 +115,18 @@ namespace xgm
     };
 
     if (!enable[i])
+    {
+      NoDividerSteps(steps[i]);
       return 0;
+    }
 
     if (!halt)
     {
-      counter[i] += clocks;
-      while(counter[i] > freq2[i])
-      {
-          phase[i] = (phase[i] + 1) & 15;
-          counter[i] -= (freq2[i] + 1);
-      }
+      UINT32 n = DivideUp(counter[i], clocks, freq2[i], steps[i]);
+      phase[i] = (phase[i] + n) & 15;
     }
+    else
+      NoDividerSteps(steps[i]);
 
     return (gate[i]
       || sqrtbl[duty[i]][phase[i]])? volume[i] : 0;
@@ -131,28 +135,32 @@ namespace xgm
   INT16 NES_VRC6::calc_saw (UINT32 clocks)
   {
     if (!enable[2])
+    {
+      NoDividerSteps(steps[2]);
       return 0;
+    }
 
     if (!halt)
     {
-      counter[2] += clocks;
-      while(counter[2] > freq2[2])
+      UINT32 n = DivideUp(counter[2], clocks, freq2[2], steps[2]);
+
+      // accumulate saw: count14 runs 0..13, resetting the accumulator on
+      // wrapping to 0 and adding volume on every even count after that
+      // (note 8-bit wrapping behaviour)
+      UINT32 total = count14 + n;
+      if (total < 14)
       {
-          counter[2] -= (freq2[2] + 1);
-
-          // accumulate saw
-          ++count14;
-          if (count14 >= 14)
-          {
-            count14 = 0;
-            phase[2] = 0;
-          }
-          else if (0 == (count14 & 1)) // only accumulate on even ticks
-          {
-            phase[2] = (phase[2] + volume[2]) & 0xFF; // note 8-bit wrapping behaviour
-          }
+        phase[2] = (phase[2] + volume[2] * (total/2 - count14/2)) & 0xFF;
+        count14 = total;
+      }
+      else
+      {
+        count14 = total % 14;
+        phase[2] = (volume[2] * (count14/2)) & 0xFF;
       }
     }
+    else
+      NoDividerSteps(steps[2]);
 
     // only top 5 bits of saw are output
     return phase[2] >> 3;
@@ -1,6 +1,7 @@
 #ifndef _NES_VRC6_H_
 #define _NES_VRC6_H_
 #include "../device.h"
+#include "divider.h"
 
 namespace xgm
 {
@@ -17,6 +18,7 @@ namespace xgm
     UINT32 phase[3];   // phase counter
     UINT32 freq2[3];   // adjusted frequency
     int count14;       // saw 14-stage counter
+    DividerSteps steps[3]; // phase steps of the last Tick
 
     //int option[OPT_END];
     int mask;
@@ -49,6 +51,10 @@ namespace xgm
     virtual void SetMask (int m){ mask = m; }
     virtual void SetStereoMix (int trk, xgm::INT16 mixl, xgm::INT16 mixr);
     virtual ITrackInfo *GetTrackInfo(int trk);
+
+    // divider steps of channel trk during the last Tick
+    // (the saw accumulates on every second one)
+    const DividerSteps & GetDividerSteps(int trk) const { return steps[trk]; }
   };
 
 }                               // namespace
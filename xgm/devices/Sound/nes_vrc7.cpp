@@ -141,6 +141,16 @@ namespace xgm
     }
   }
 
+  void NES_VRC7::TickState (UINT32 clocks)
+  {
+    divider += clocks;
+    while (divider >= 36)
+    {
+        divider -= 36;
+        OPLL_calcState(opll);
+    }
+  }
+
   UINT32 NES_VRC7::Render (INT32 b[2])
   {
     b[0] = b[1] = 0;
@@ -6,6 +6,7 @@
 #include "../xtypes.h"
 #include "devinfo.h"
 #include "../debugout.h"
+#include "Misc/profiler.h"
 
 namespace xgm
 {
@@ -92,6 +93,15 @@ namespace xgm
      */
     virtual void Tick (UINT32 clocks) = 0;
 
+    /**
+     * Advances the chip like Tick while its output is being discarded
+     * (muted, or every channel masked). Registers, counters, length and
+     * envelope units and anything readable from the bus keep up exactly;
+     * the output values may be left as of the last Tick.
+     * Chips without a cheaper path just Tick.
+     */
+    virtual void TickState (UINT32 clocks) { Tick (clocks); }
+
     /**
      * `bv̓NbNݒ
      *
@@ -235,7 +245,15 @@ namespace xgm
   class Layer : public Bus
   {
   protected:
+    Profiler * profiler; // counts which device claims each access
   public:
+    Layer () : profiler (NULL) {}
+
+    void SetProfiler (Profiler * p)
+    {
+      profiler = p;
+    }
+
     /**
      * 
      *
@@ -250,7 +268,11 @@ namespace xgm
       std::vector < IDevice * >::iterator it;
       for (it = vd.begin (); it != vd.end (); it++)
         if ((*it)->Write (adr, val))
+        {
+          PROFILE_BUS_WRITE (profiler, *it);
           return true;
+        }
+      PROFILE_BUS_WRITE (profiler, NULL);
       return false;
     }
 
@@ -269,7 +291,11 @@ namespace xgm
       val = 0;
       for (it = vd.begin (); it != vd.end (); it++)
         if ((*it)->Read (adr, val))
+        {
+          PROFILE_BUS_READ (profiler, *it);
           return true;
+        }
+      PROFILE_BUS_READ (profiler, NULL);
       return false;
     }
   };
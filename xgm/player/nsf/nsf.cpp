@@ -410,6 +410,114 @@ void sjis_legacy(char* s, const unsigned int length)
     return false;
   }
 
+  bool NSF::LoadMetadata (const char *fn)
+  {
+    FILE *fp = NULL;
+    UINT8 *buf = NULL;
+    UINT8 header[0x80];
+    UINT32 size = 0;
+    long end;
+    bool result = false;
+    nsf_error = "";
+    nsfe_error = "";
+
+    strncpy (filename, fn, NSF_MAX_PATH);
+    filename[NSF_MAX_PATH - 1] = '\0';
+    fp = fopen_utf8(filename, "rb");
+    if (fp == NULL)
+    {
+      nsf_error = "Could not open file.";
+      return false;
+    }
+    fseek (fp, 0L, SEEK_END);
+    end = ftell (fp);
+    fseek (fp, 0L, SEEK_SET);
+
+    ClearNSFe ();
+    delete[]body;
+    body = NULL;
+    bodysize = 0;
+
+    if (fread (header, 1, 4, fp) != 4)
+    {
+      nsf_error = "File too small for FourCC ID.";
+      goto Exit;
+    }
+    memcpy (magic, header, 4);
+    magic[4] = '\0';
+
+    if (!strcmp ("NESM", magic))
+    {
+      // header, then only the NSF2 metadata after the program
+      if (fread (header + 4, 1, 0x80 - 4, fp) != 0x80 - 4)
+      {
+        nsf_error = "File too small for NSF header.";
+        goto Exit;
+      }
+      UINT32 suffix = LoadHeader (header);
+      result = true;
+      if (suffix != 0 && long(0x80 + suffix) < end)
+      {
+        size = UINT32(end - (0x80 + suffix));
+        buf = new UINT8[size];
+        fseek (fp, 0x80 + suffix, SEEK_SET);
+        if (fread (buf, 1, size, fp) != size)
+        {
+          nsf_error = "File size mismatch? Corrupt file?";
+          result = false;
+          goto Exit;
+        }
+        if (!LoadNSFe(buf, size, true) && (nsf2_bits & 0x80))
+        {
+          nsf_error = nsfe_error;
+          result = false;
+        }
+      }
+    }
+    else
+    {
+      // copy every chunk but DATA, which is skipped over
+      buf = new UINT8[end + 1];
+      memcpy (buf, header, 4);
+      size = 4;
+      while (ftell (fp) + 8 <= end)
+      {
+        UINT8 *chunk = buf + size;
+        if (fread (chunk, 1, 8, fp) != 8) break;
+        UINT32 chunk_size = chunk[0] | (chunk[1] << 8) | (chunk[2] << 16) | (UINT32(chunk[3]) << 24);
+        if (ftell (fp) + long(chunk_size) > end)
+        {
+          size += 8; // let LoadNSFe report the short chunk
+          break;
+        }
+        if (!memcmp (chunk + 4, "DATA", 4))
+        {
+          fseek (fp, chunk_size, SEEK_CUR);
+          continue;
+        }
+        if (fread (chunk + 8, 1, chunk_size, fp) != chunk_size) break;
+        size += 8 + chunk_size;
+        if (!memcmp (chunk + 4, "NEND", 4)) break;
+      }
+      result = LoadNSFe(buf, size, false);
+      nsf_error = nsfe_error;
+    }
+
+    playlist_mode = false;
+    title_unknown = true;
+    enable_multi_tracks = true;
+    time_in_ms = -1;
+    loop_in_ms = -1;
+    fade_in_ms = -1;
+    loop_num = -1;
+    playtime_unknown = true;
+
+  Exit:
+    delete[]buf;
+    fclose (fp);
+    return result;
+  }
+
   void NSF::SetLength (int t)
   {
     time_in_ms = t;
@@ -482,17 +590,8 @@ void sjis_legacy(char* s, const unsigned int length)
     title_unknown = true;
   }
 
-  bool NSF::Load (UINT8 * image, UINT32 size)
+  void NSF::ClearNSFe ()
   {
-    nsf_error = "";
-    nsfe_error = "";
-
-    if (size < 4) // no FourCC
-    {
-      nsf_error = "File too small for FourCC ID.";
-      return false;
-    }
-
     nsf2_bits = 0;
     vrc7_type = -1; // default
     vrc7_patches = NULL; // none
@@ -515,25 +614,10 @@ void sjis_legacy(char* s, const unsigned int length)
 
     // 'mixe'
     for (unsigned int i=0; i<NSFE_MIXES; ++i) nsfe_mixe[i] = NSFE_MIXE_DEFAULT;
+  }
 
-    // load the NSF or NSFe
-
-    memcpy (magic, image, 4);
-    magic[4] = '\0';
-
-    if (strcmp ("NESM", magic))
-    {
-      bool result = LoadNSFe(image, size, false);
-      nsf_error = nsfe_error;
-      return result;
-    }
-
-    if (size < 0x80) // no header?
-    {
-      nsf_error = "File too small for NSF header.";
-      return false;
-    }
-
+  UINT32 NSF::LoadHeader (const UINT8 * image)
+  {
     version = image[0x05];
     total_songs = songs = image[0x06];
     start = image[0x07];
@@ -584,13 +668,48 @@ void sjis_legacy(char* s, const unsigned int length)
 
     memcpy (extra, image + 0x7c, 4);
 
+    song = start - 1;
+    return suffix;
+  }
+
+  bool NSF::Load (UINT8 * image, UINT32 size)
+  {
+    nsf_error = "";
+    nsfe_error = "";
+
+    if (size < 4) // no FourCC
+    {
+      nsf_error = "File too small for FourCC ID.";
+      return false;
+    }
+
+    ClearNSFe ();
+
+    // load the NSF or NSFe
+
+    memcpy (magic, image, 4);
+    magic[4] = '\0';
+
+    if (strcmp ("NESM", magic))
+    {
+      bool result = LoadNSFe(image, size, false);
+      nsf_error = nsfe_error;
+      return result;
+    }
+
+    if (size < 0x80) // no header?
+    {
+      nsf_error = "File too small for NSF header.";
+      return false;
+    }
+
+    UINT32 suffix = LoadHeader (image);
+
     delete[]body;
     body = new UINT8[size - 0x80];
     memcpy (body, image + 0x80, size - 0x80);
     bodysize = size - 0x80;
 
-    song = start - 1;
-
     if (suffix != 0)
     {
         suffix += 0x80; // add header to suffix location
@@ -98,12 +98,25 @@ namespace xgm
     // loads file (playlist or NSF or NSFe)
     bool LoadFile (const char *fn);
 
+    // loads only the header and NSFe/NSF2 metadata chunks of an NSF or NSFe
+    // file, skipping the program; the result can be inspected but not played
+    bool LoadMetadata (const char *fn);
+
     // loads NSF (or NSFe via LoadNSFe)
     bool Load (UINT8 * image, UINT32 size);
 
     // loads NSFe, or NSFe suffix for NSF2
     bool LoadNSFe(UINT8* image, UINT32 size, bool nsf2);
 
+  protected:
+    // resets the NSFe/NSF2 fields before a load
+    void ClearNSFe ();
+
+    // reads the 0x80 byte NSF header, returns the NSF2 metadata offset
+    UINT32 LoadHeader (const UINT8 * image);
+
+  public:
+
     // returns descriptive error of last Load (English only)
     const char* LoadError();
 
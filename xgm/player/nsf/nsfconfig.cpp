@@ -25,7 +25,7 @@ const char *NSFPlayerConfig::channel_name[NES_CHANNEL_MAX] =
       "VRC7:6", "VRC7:7", "VRC7:8",
   };
 
-int NSFPlayerConfig::channel_device[NES_CHANNEL_MAX] =
+const int NSFPlayerConfig::channel_device[NES_CHANNEL_MAX] =
   {
       APU, APU, DMC, DMC, DMC,
       FDS,
@@ -37,7 +37,7 @@ int NSFPlayerConfig::channel_device[NES_CHANNEL_MAX] =
       VRC7, VRC7, VRC7,
   };
 
-int NSFPlayerConfig::channel_device_index[NES_CHANNEL_MAX] =
+const int NSFPlayerConfig::channel_device_index[NES_CHANNEL_MAX] =
   {
       0, 1, 0, 1, 2,
       0,
@@ -49,7 +49,7 @@ int NSFPlayerConfig::channel_device_index[NES_CHANNEL_MAX] =
       6, 7, 8,
   };
 
-int NSFPlayerConfig::channel_track[NES_CHANNEL_MAX] =
+const int NSFPlayerConfig::channel_track[NES_CHANNEL_MAX] =
   {
     NSFPlayer::APU1_TRK0, NSFPlayer::APU1_TRK1, NSFPlayer::APU2_TRK0,
     NSFPlayer::APU2_TRK1, NSFPlayer::APU2_TRK2,
@@ -97,6 +97,12 @@ NSFPlayerConfig::NSFPlayerConfig () : PlayerConfig ()
   CreateValue("DETECT_INT", 5000);
   CreateValue("LPF", 112);
   CreateValue("HPF", 164);
+  CreateValue("OUTPUT_FILTER", 0); // 1 = NES output model instead of HPF/LPF
+  CreateValue("ECHO", 0);
+  CreateValue("ECHO_DELAY", 62); // ms between echo taps
+  CreateValue("LOUDNESS", 0); // 1 = measure R128 loudness of the output
+  CreateValue("OVERVIEW_MS", 0); // waveform overview bucket length, 0 = off
+  CreateValue("PIPELINE", 0); // 1 = render VRC7, N163 and FDS on worker threads
   CreateValue("TITLE_FORMAT", "%L (%n/%e) %T - %A");
   CreateValue("DETECT_ALT", 0);
   CreateValue("VSYNC_ADJUST", 0);
@@ -111,6 +117,7 @@ NSFPlayerConfig::NSFPlayerConfig () : PlayerConfig ()
   CreateValue("REGION", 0);
   CreateValue("LOG_CPU", 0);
   CreateValue("LOG_CPU_FILE", "nsf_write.log");
+  CreateValue("PROFILE_CPU", 0); // 6502 hot-spot profile (NSFPLAY_PROFILE builds only)
 
   CreateValue("PLAY_ADVANCE", 0);
   CreateValue("FAST_SEEK", 1);
@@ -174,7 +181,7 @@ NSFPlayerConfig::NSFPlayerConfig () : PlayerConfig ()
 
     for (j = 0; j < DEVICE_OPTION_MAX[i]; j++)
     {
-      static char itoa[] = "0123456789ABCDEF";
+      static const char itoa[] = "0123456789ABCDEF";
       CreateValue((std::string)dname[i]+"_OPTION"+itoa[j], DEFAULT_DEVICE_OPTION[i][j]);
     }
   }
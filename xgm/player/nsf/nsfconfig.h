@@ -25,7 +25,7 @@ namespace xgm
     vcm::Value& GetDeviceOption(int id, int opt)
     {
       MutexGuard mg_(this);
-      static char itoa[] = "0123456789ABCDEF";
+      static const char itoa[] = "0123456789ABCDEF";
       return data[(std::string)dname[id]+"_OPTION"+itoa[opt]];
     }
 
@@ -51,9 +51,9 @@ namespace xgm
 
     // for channel/pan/mix
     static const char *channel_name[NES_CHANNEL_MAX]; // name of channel
-    static int channel_device[NES_CHANNEL_MAX]; // device enum of channel
-    static int channel_device_index[NES_CHANNEL_MAX]; // device channel index
-    static int channel_track[NES_CHANNEL_MAX]; // trackinfo for channel
+    static const int channel_device[NES_CHANNEL_MAX]; // device enum of channel
+    static const int channel_device_index[NES_CHANNEL_MAX]; // device channel index
+    static const int channel_track[NES_CHANNEL_MAX]; // trackinfo for channel
   };
 
 }// namespace
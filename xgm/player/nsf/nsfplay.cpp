@@ -9,6 +9,11 @@ namespace xgm
 {
   int debug_mark = 0;
 
+  static const char* PROFILE_TICK_NAME[NES_DEVICE_MAX] =
+    { "APU1 tick", "APU2 tick", "5B tick", "MMC5 tick", "N163 tick", "VRC6 tick", "VRC7 tick", "FDS tick" };
+  static const char* PROFILE_RENDER_NAME[NES_DEVICE_MAX] =
+    { "APU1 render", "APU2 render", "5B render", "MMC5 render", "N163 render", "VRC6 render", "VRC7 render", "FDS render" };
+
   NSFPlayer::NSFPlayer () : PlayerMSP ()
   {
     nsf = NULL;
@@ -37,10 +42,27 @@ namespace xgm
 
     rconv.Attach(&mixer);
     fader.Attach(&rconv);
+    pipeline.SetConverter(&rconv);
+
+    // profiler hooks (no effect unless built with NSFPLAY_PROFILE)
+    profiler.SetSlotName(Profiler::RATE_CONVERTER, "rconv");
+    profiler.SetSlotName(Profiler::CPU_EXEC, "CPU exec", Profiler::RATE_CONVERTER);
+    profiler.SetSlotName(Profiler::DC_FILTER, "DC filter");
+    profiler.SetSlotName(Profiler::LOW_PASS_FILTER, "lowpass filter");
+    profiler.SetSlotName(Profiler::LOOP_DETECT, "loop detect");
+    for (int i = 0; i < NES_DEVICE_MAX; i++)
+    {
+      profiler.SetSlotName(Profiler::CHIP_TICK + i, PROFILE_TICK_NAME[i], Profiler::RATE_CONVERTER);
+      profiler.SetSlotName(Profiler::CHIP_RENDER + i, PROFILE_RENDER_NAME[i], Profiler::RATE_CONVERTER);
+      amp[i].SetProfiler(&profiler, i);
+    }
+    rconv.SetProfiler(&profiler);
+    stack.SetProfiler(&profiler);
 
     nch = 1;
     infinite = false;
     last_out = 0;
+    output_filter = 0;
   }
 
   NSFPlayer::~NSFPlayer ()
@@ -121,6 +143,7 @@ namespace xgm
     layer.DetachAll ();
     mixer.DetachAll ();
     apu_bus.DetachAll ();
+    pipeline.Clear ();
 
     // select the loop detector
     if((*config)["DETECT_ALT"])
@@ -162,6 +185,17 @@ namespace xgm
         cpu.SetLogger(NULL);
     }
 
+    if ((*config)["PROFILE_CPU"].GetInt() && Profiler::Enabled())
+    {
+        profcpu.SetEnable(true);
+        profcpu.SetBank(bmax ? &bank : NULL);
+        cpu.SetProfiler(&profcpu);
+    }
+    else
+    {
+        cpu.SetProfiler(NULL);
+    }
+
     // setup player program at PLAYER_RESERVED ($4100)
     const UINT8 PLAYER_PROGRAM[] =
     {
@@ -222,6 +256,10 @@ namespace xgm
     rconv.SetDMC(dmc);
     rconv.SetMMC5(NULL);
 
+    // the heavy expansions only pay for the worker threads when there are two to run in parallel
+    int heavy = int(nsf->use_vrc7) + int(nsf->use_n106) + int(nsf->use_fds);
+    bool pipe = (*config)["PIPELINE"].GetInt() != 0 && heavy >= 2 && !Profiler::Enabled();
+
     if (nsf->use_mmc5)
     {
       stack.Attach (sc[MMC5]);
@@ -248,8 +286,7 @@ namespace xgm
       vrc7->UseAllChannels(opll);
       vrc7->SetPatchSet(patch_set);
       vrc7->SetPatchSetCustom(nsf->vrc7_patches);
-      stack.Attach (sc[VRC7]);
-      mixer.Attach (&amp[VRC7]);
+      AttachExpansion (VRC7, pipe, &vrc7_state, NULL); // write-only, the state copy just claims writes
     }
     if (nsf->use_fme7)
     {
@@ -258,8 +295,7 @@ namespace xgm
     }
     if (nsf->use_n106)
     {
-      stack.Attach (sc[N106]);
-      mixer.Attach (&amp[N106]);
+      AttachExpansion (N106, pipe, &n106_state, ChipPipeline::Copy<NES_N106>);
     }
     if (nsf->use_fds)
     {
@@ -273,8 +309,7 @@ namespace xgm
 
       if (multichip) write_enable = false;
 
-      stack.Attach (sc[FDS]); // last before memory layer
-      mixer.Attach (&amp[FDS]);
+      AttachExpansion (FDS, pipe, &fds_state, ChipPipeline::Copy<NES_FDS>); // last before memory layer
       mem.SetFDSMode (write_enable);
       bank.SetFDSMode (write_enable);
 
@@ -293,6 +328,16 @@ namespace xgm
     // memory layer comes last
     stack.Attach (&layer);
 
+    profiler.ClearBusNames();
+    profiler.SetBusName(ld, "loop detect");
+    profiler.SetBusName(logcpu, "CPU log");
+    profiler.SetBusName(&nsf2_irq, "NSF2 IRQ");
+    profiler.SetBusName(&apu_bus, "APU");
+    for (i = 0; i < NES_DEVICE_MAX; i++)
+      if (i != APU && i != DMC)
+        profiler.SetBusName(sc[i], config->dname[i]);
+    profiler.SetBusName(&layer, "memory");
+
     // NOTE: each layer in the stack is given a chance to take a read or write
     // exclusively. The stack is structured like this:
     //     loop detector > APU > expansions > main memory
@@ -310,6 +355,22 @@ namespace xgm
 	cpu.SetNESMemory (&mem);
   }
 
+  // a pipelined chip is reached through its lane, see ChipPipeline
+  void NSFPlayer::AttachExpansion (int id, bool pipe, ISoundChip * state, ChipPipeline::CopyState copy)
+  {
+    if (pipe)
+    {
+      ChipPipeline::Lane *lane = pipeline.Add (&amp[id], sc[id], state, copy);
+      stack.Attach (lane);
+      mixer.Attach (lane);
+    }
+    else
+    {
+      stack.Attach (sc[id]);
+      mixer.Attach (&amp[id]);
+    }
+  }
+
 void NSFPlayer::SetPlayFreq (double r)
 {
 	rate = r;
@@ -349,11 +410,18 @@ void NSFPlayer::SetPlayFreq (double r)
 
 	mixer.Reset();
 	rconv.Reset();
+	pipeline.Reset();
 	fader.Reset();
 	lpf.SetRate(rate);
 	lpf.Reset();
 	dcf.SetRate(rate);
 	dcf.Reset(); 
+	nesf.SetRate(rate);
+	nesf.Reset();
+	echo.SetRate(rate);
+	echo.Reset();
+	loudness.SetRate(rate);
+	overview.SetRate(rate);
 	DEBUG_OUT("rate: %f\n",rate);
 }
 
@@ -449,6 +517,7 @@ void NSFPlayer::SetPlayFreq (double r)
     vrc6->SetMask((*config)["MASK"].GetInt()>>12);
     vrc7->SetMask((*config)["MASK"].GetInt()>>15);
     n106->SetMask((*config)["MASK"].GetInt()>>21);
+    NotifyMask(-1);
 
     for(int i=0;i<NES_TRACK_MAX;i++)
       infobuf[i].Clear();
@@ -463,6 +532,7 @@ void NSFPlayer::SetPlayFreq (double r)
     fader.Tick(0);
     for (int i=0; i < (quality+1); ++i) fader.Render(b); // warm up rconv/render with enough sample to reach a steady state
     dcf.SetLevel(b); // DC filter will use the current DC level as its starting state
+    nesf.SetLevel(b);
   }
 
   void NSFPlayer::DetectSilent ()
@@ -487,6 +557,7 @@ void NSFPlayer::SetPlayFreq (double r)
 
     if ((*config)["AUTO_DETECT"])
     {
+      PROFILE_SCOPE(&profiler, Profiler::LOOP_DETECT, 0);
       if (ld->IsLooped (time_in_ms, (*config)["DETECT_TIME"], (*config)["DETECT_INT"]))
       {
         playtime_detected = true;
@@ -550,6 +621,7 @@ void NSFPlayer::SetPlayFreq (double r)
 
         fader.Skip(); // execute CPU/APU ticks via rconv.Skip
       }
+      PROFILE_SAMPLES(&profiler, length);
 
       time_in_ms += (int)(1000 * length / rate * mult_speed / 256) ;
       CheckTerminal ();
@@ -629,24 +701,8 @@ void NSFPlayer::SetPlayFreq (double r)
     }
   }
 
-  UINT32 NSFPlayer::Render (INT16 * b, UINT32 length)
+  void NSFPlayer::TickFrame (double cpu_clock_per_sample, double apu_clock_per_sample)
   {
-    INT32 buf[2];
-    INT32 out[2];
-    INT32 outm;
-    UINT32 i;
-    int master_volume;
-
-    master_volume = (*config)["MASTER_VOLUME"];
-
-    int mult_speed = (*config)["MULT_SPEED"].GetInt();
-    double apu_clock_per_sample = cpu.nes_basecycles / rate;
-    double cpu_clock_per_sample = apu_clock_per_sample * ((double)(mult_speed)/256.0);
-
-    for (i = 0; i < length; i++)
-    {
-      total_render++;
-
       // tick CPU
       cpu_clock_rest += cpu_clock_per_sample;
       int cpu_clocks = (int)(cpu_clock_rest);
@@ -673,61 +729,286 @@ void NSFPlayer::SetPlayFreq (double r)
           fader.Tick(apu_clocks);
           apu_clock_rest -= (double)(apu_clocks);
       }
+  }
 
-      // render output
-      fader.Render(buf); // ticks APU/CPU and renders with subdivision and resampling (also does UpdateInfo)
-      outm = (buf[0] + buf[1]) >> 1; // mono mix
+  void NSFPlayer::EndFrame (INT32 buf[2])
+  {
+      INT32 outm = (buf[0] + buf[1]) >> 1; // mono mix
       if (outm == last_out) silent_length++; else silent_length = 0;
       last_out = outm;
+  }
 
-      // echo.FastRender(buf);
-      dcf.FastRender(buf);
-      lpf.FastRender(buf);
+  void NSFPlayer::RenderFrame (INT32 buf[2], double cpu_clock_per_sample, double apu_clock_per_sample)
+  {
+      total_render++;
+      TickFrame(cpu_clock_per_sample, apu_clock_per_sample);
 
-      out[0] = buf[0];
-      out[1] = buf[1];
-      out[0] = (out[0]*master_volume)>>8;
-      out[1] = (out[1]*master_volume)>>8;
+      // render output
+      fader.Render(buf); // ticks APU/CPU and renders with subdivision and resampling (also does UpdateInfo)
+      EndFrame(buf);
+  }
 
-      if     (out[0]<-32767) out[0]=-32767;
-      else if( 32767<out[0]) out[0]= 32767;
+  // the rest of RenderFrame, once the pipelined chips are in the sum
+  void NSFPlayer::FinishBlock (const INT64 * sum, INT32 * buf, UINT32 frames)
+  {
+      pipeline.Wait();
+      for (UINT32 i = 0; i < frames; i++)
+      {
+          total_render++;
+          RateConverter::Scale(&sum[i*2], &buf[i*2]);
+          fader.Apply(&buf[i*2]);
+          EndFrame(&buf[i*2]);
+          UpdateInfo();
+      }
+  }
 
-      if     (out[1]<-32767) out[1]=-32767;
-      else if( 32767<out[1]) out[1]= 32767;
+  // Emulates length frames and hands them to output a block at a time.
+  // With the pipeline, the CPU emulates each block while the worker threads
+  // render the pipelined chips of the one before it, so a block is output
+  // once the next one has been emulated, and its info snapshots are taken
+  // then, up to two blocks late.
+  void NSFPlayer::RenderBlocks (UINT32 length, double cpu_clock_per_sample, double apu_clock_per_sample, const std::function<void (INT32 *, UINT32)> & output)
+  {
+      INT32 buf[RENDER_BLOCK*2];
+      UINT32 i, n;
 
-      #if _DEBUG
-          if (debug_mark)
+      if (!pipeline.IsActive())
+      {
+          for (UINT32 done = 0; done < length; done += n)
           {
-              out[0] = debug_mark;
-              debug_mark = 0;
+              n = length - done;
+              if (n > RENDER_BLOCK) n = RENDER_BLOCK;
+              for (i = 0; i < n; i++)
+              {
+                  RenderFrame(&buf[i*2], cpu_clock_per_sample, apu_clock_per_sample);
+                  UpdateInfo();
+              }
+              output(buf, n);
           }
-      #endif
+          return;
+      }
+
+      INT64 sum[2][RENDER_BLOCK*2];
+      UINT32 pending = 0;
+      int cur = 0;
 
-      if (nch == 2)
+      pipeline.Sync();
+      for (UINT32 done = 0; done < length; done += n)
       {
-          b[0] = out[0];
-          b[1] = out[1];
+          n = length - done;
+          if (n > RENDER_BLOCK) n = RENDER_BLOCK;
+
+          pipeline.Begin();
+          for (i = 0; i < n; i++)
+          {
+              TickFrame(cpu_clock_per_sample, apu_clock_per_sample);
+              rconv.RenderSum(&sum[cur][i*2]);
+          }
+          if (pending)
+          {
+              FinishBlock(sum[cur^1], buf, pending);
+              output(buf, pending);
+          }
+          pipeline.Submit(sum[cur], n);
+          pending = n;
+          cur ^= 1;
       }
-      else // if not 2 channels, presume mono
+      if (pending)
       {
-          outm = (out[0] + out[1]) >> 1;
-          for (int i=0; i < nch; ++i)
-              b[0] = outm;
+          FinishBlock(sum[cur^1], buf, pending);
+          output(buf, pending);
       }
-      b += nch;
-
-      UpdateInfo();
-    }
+  }
 
+  void NSFPlayer::RenderEnd (UINT32 length, int mult_speed)
+  {
     time_in_ms += (int)(1000 * length / rate * mult_speed / 256);
+    PROFILE_SAMPLES(&profiler, length);
 
     CheckTerminal ();
     DetectLoop ();
     DetectSilent ();
+  }
 
+  // final filters over a block of interleaved stereo frames
+  void NSFPlayer::FilterBlock (INT32 * buf, UINT32 frames)
+  {
+    if (output_filter)
+    {
+      PROFILE_SCOPE(&profiler, Profiler::DC_FILTER, 0);
+      nesf.RenderBlock(buf, frames);
+      return;
+    }
+    {
+      PROFILE_SCOPE(&profiler, Profiler::DC_FILTER, 0);
+      dcf.RenderBlock(buf, frames);
+    }
+    {
+      PROFILE_SCOPE(&profiler, Profiler::LOW_PASS_FILTER, 0);
+      lpf.RenderBlock(buf, frames);
+    }
+  }
+
+  void NSFPlayer::FilterBlockFloat (double * buf, UINT32 frames)
+  {
+    if (output_filter)
+    {
+      PROFILE_SCOPE(&profiler, Profiler::DC_FILTER, 0);
+      nesf.RenderBlockFloat(buf, frames);
+      return;
+    }
+    {
+      PROFILE_SCOPE(&profiler, Profiler::DC_FILTER, 0);
+      dcf.RenderBlockFloat(buf, frames);
+    }
+    {
+      PROFILE_SCOPE(&profiler, Profiler::LOW_PASS_FILTER, 0);
+      lpf.RenderBlockFloat(buf, frames);
+    }
+  }
+
+  UINT32 NSFPlayer::Render (INT16 * b, UINT32 length)
+  {
+    INT32 out[2];
+    INT32 outm;
+    UINT32 i;
+    int master_volume;
+
+    master_volume = (*config)["MASTER_VOLUME"];
+
+    int mult_speed = (*config)["MULT_SPEED"].GetInt();
+    double apu_clock_per_sample = cpu.nes_basecycles / rate;
+    double cpu_clock_per_sample = apu_clock_per_sample * ((double)(mult_speed)/256.0);
+
+    // filter and output each emulated block
+    RenderBlocks(length, cpu_clock_per_sample, apu_clock_per_sample, [&](INT32 * buf, UINT32 n)
+    {
+      INT16 *block = b;
+
+      echo.RenderBlock(buf, n);
+      FilterBlock(buf, n);
+
+      for (i = 0; i < n; i++)
+      {
+        out[0] = buf[i*2+0];
+        out[1] = buf[i*2+1];
+        out[0] = (out[0]*master_volume)>>8;
+        out[1] = (out[1]*master_volume)>>8;
+
+        if     (out[0]<-32767) out[0]=-32767;
+        else if( 32767<out[0]) out[0]= 32767;
+
+        if     (out[1]<-32767) out[1]=-32767;
+        else if( 32767<out[1]) out[1]= 32767;
+
+        #if _DEBUG
+            if (debug_mark)
+            {
+                out[0] = debug_mark;
+                debug_mark = 0;
+            }
+        #endif
+
+        if (nch == 2)
+        {
+            b[0] = out[0];
+            b[1] = out[1];
+        }
+        else // if not 2 channels, presume mono
+        {
+            outm = (out[0] + out[1]) >> 1;
+            for (int i=0; i < nch; ++i)
+                b[0] = outm;
+        }
+        b += nch;
+      }
+
+      if (loudness.IsEnabled() || overview.IsEnabled())
+      {
+        double m[RENDER_BLOCK*2];
+        for (i = 0; i < n*nch; i++) m[i] = block[i] / 32768.0;
+        loudness.Process(m, n, nch);
+        overview.Process(m, n, nch);
+      }
+    });
+
+    RenderEnd(length, mult_speed);
     return length;
   }
 
+  // Same as Render up to the final filters, which then run in double
+  // precision. fb receives floats scaled to 1.0 = INT16 full scale,
+  // otherwise ib receives 24-bit integers.
+  UINT32 NSFPlayer::RenderHeadroom (float * fb, INT32 * ib, UINT32 length)
+  {
+    double buf[RENDER_BLOCK*2];
+    UINT32 i;
+
+    const double scale = double((*config)["MASTER_VOLUME"].GetInt()) / (256.0 * 32768.0);
+    const double FULL24 = 8388608.0;
+
+    int mult_speed = (*config)["MULT_SPEED"].GetInt();
+    double apu_clock_per_sample = cpu.nes_basecycles / rate;
+    double cpu_clock_per_sample = apu_clock_per_sample * ((double)(mult_speed)/256.0);
+
+    RenderBlocks(length, cpu_clock_per_sample, apu_clock_per_sample, [&](INT32 * frame, UINT32 n)
+    {
+      double *m = buf; // reused for the metered output
+
+      echo.RenderBlock(frame, n);
+      for (i = 0; i < n*2; i++) buf[i] = frame[i];
+
+      FilterBlockFloat(buf, n);
+
+      for (i = 0; i < n; i++)
+      {
+        double out[2];
+        out[0] = buf[i*2+0] * scale;
+        out[1] = buf[i*2+1] * scale;
+        int nc = 2;
+        if (nch != 2) // if not 2 channels, presume mono
+        {
+          out[0] = (out[0] + out[1]) * 0.5;
+          nc = 1;
+        }
+
+        for (int c=0; c < nc; ++c)
+        {
+          if (fb)
+          {
+            fb[c] = float(out[c]);
+            *m++ = fb[c];
+          }
+          else
+          {
+            double s = out[c] * FULL24;
+            if      (s < -(FULL24-1.0)) s = -(FULL24-1.0);
+            else if (s >  (FULL24-1.0)) s =  (FULL24-1.0);
+            ib[c] = INT32(s < 0.0 ? s - 0.5 : s + 0.5);
+            *m++ = ib[c] / FULL24;
+          }
+        }
+        if (fb) fb += nch; else ib += nch;
+      }
+
+      loudness.Process(buf, n, nch);
+      overview.Process(buf, n, nch);
+    });
+
+    RenderEnd(length, mult_speed);
+    return length;
+  }
+
+  UINT32 NSFPlayer::RenderFloat (float * b, UINT32 length)
+  {
+    return RenderHeadroom(b, NULL, length);
+  }
+
+  UINT32 NSFPlayer::Render24 (INT32 * b, UINT32 length)
+  {
+    return RenderHeadroom(NULL, b, length);
+  }
+
   int NSFPlayer::GetLength ()
   {
     if (nsf == NULL) return 0;
@@ -790,7 +1071,7 @@ void NSFPlayer::SetPlayFreq (double r)
 
   void NSFPlayer::GetMemoryString (char *buf)
   {
-    static char itoa[] = "0123456789ABCDEF";
+    static const char itoa[] = "0123456789ABCDEF";
     UINT32 val;
     int i, t = 0;
 
@@ -832,6 +1113,11 @@ void NSFPlayer::SetPlayFreq (double r)
 
       dcf.SetParam(270,(*config)["HPF"]);
       lpf.SetParam(4700.0,(*config)["LPF"]);
+      output_filter = (*config)["OUTPUT_FILTER"];
+      echo.SetDelay((*config)["ECHO_DELAY"].GetInt());
+      echo.SetEnable((*config)["ECHO"].GetInt() != 0);
+      loudness.SetEnable((*config)["LOUDNESS"].GetInt() != 0);
+      overview.SetBucket((*config)["OVERVIEW_MS"].GetInt());
 
       //DEBUG_OUT("dcf: %3d > %f\n", (*config)["HPF"].GetInt(), dcf.GetFactor());
       //DEBUG_OUT("lpf: %3d > %f\n", (*config)["LPF"].GetInt(), lpf.GetFactor());
@@ -929,9 +1215,30 @@ void NSFPlayer::SetPlayFreq (double r)
     }
 
     NotifyPan(id);
+    NotifyMask(id);
     UpdateInfinite();
   }
 
+  void NSFPlayer::NotifyMask (int id)
+  {
+    if (id == -1)
+    {
+      for (int i = 0; i < NES_DEVICE_MAX; i++)
+        NotifyMask (i);
+      return;
+    }
+
+    // a device with every channel masked is only ticked for its state
+    int mask = (*config)["MASK"].GetInt();
+    bool masked = true;
+    for (int i=0;i<NES_CHANNEL_MAX;++i)
+    {
+        if (config->channel_device[i] == id && !((mask >> i) & 1))
+            masked = false;
+    }
+    amp[id].SetMasked(masked);
+  }
+
   void NSFPlayer::NotifyPan (int id)
   {
     if (id == -1)
@@ -1029,5 +1336,25 @@ void NSFPlayer::SetPlayFreq (double r)
       infinite = 1 == (*config)["PLAY_ADVANCE"];
   }
 
+  Profiler& NSFPlayer::GetProfile()
+  {
+      return profiler;
+  }
+
+  CPUProfiler& NSFPlayer::GetCPUProfile()
+  {
+      return profcpu;
+  }
+
+  LoudnessMeter& NSFPlayer::GetLoudness()
+  {
+      return loudness;
+  }
+
+  WaveformOverview& NSFPlayer::GetOverview()
+  {
+      return overview;
+  }
+
 }
 
@@ -1,5 +1,6 @@
 #ifndef _LIBNSF_H_
 #define _LIBNSF_H_
+#include <functional>
 #include "../player.h"
 #include "nsfconfig.h"
 #include "nsf.h"
@@ -22,10 +23,15 @@
 #include "../../devices/Audio/amplifier.h"
 #include "../../devices/Audio/rconv.h"
 #include "../../devices/Audio/echo.h"
+#include "../../devices/Audio/loudness.h"
+#include "../../devices/Audio/overview.h"
+#include "../../devices/Audio/pipeline.h"
 #include "../../devices/Audio/MedianFilter.h"
 #include "../../devices/Misc/nsf2_irq.h"
 #include "../../devices/Misc/nes_detect.h"
 #include "../../devices/Misc/log_cpu.h"
+#include "../../devices/Misc/profiler.h"
+#include "../../devices/Misc/profile_cpu.h"
 
 namespace xgm
 {
@@ -38,6 +44,9 @@ namespace xgm
     double rate;
     int nch; // number of channels
     int song;
+    int output_filter; // OUTPUT_FILTER config
+
+    enum { RENDER_BLOCK = 256 }; // frames emulated before the final filters run
 
     INT32 last_out;
     int silent_length;
@@ -49,10 +58,22 @@ namespace xgm
     bool infinite;               // never fade out
 
     void Reload ();
+    void AttachExpansion (int id, bool pipe, ISoundChip * state, ChipPipeline::CopyState copy);
     void DetectLoop ();
     void DetectSilent ();
     void CheckTerminal ();
 
+    // shared by Render, RenderFloat and Render24
+    void TickFrame (double cpu_clock_per_sample, double apu_clock_per_sample);
+    void EndFrame (INT32 b[2]);
+    void RenderFrame (INT32 b[2], double cpu_clock_per_sample, double apu_clock_per_sample);
+    void RenderBlocks (UINT32 length, double cpu_clock_per_sample, double apu_clock_per_sample, const std::function<void (INT32 *, UINT32)> & output);
+    void FinishBlock (const INT64 * sum, INT32 * buf, UINT32 frames);
+    void RenderEnd (UINT32 length, int mult_speed);
+    void FilterBlock (INT32 * buf, UINT32 frames);
+    void FilterBlockFloat (double * buf, UINT32 frames);
+    UINT32 RenderHeadroom (float * fb, INT32 * ib, UINT32 length);
+
   public:
     void UpdateInfo();
 
@@ -73,8 +94,18 @@ namespace xgm
     RateConverter rconv;
     DCFilter dcf;                        // �ŏI�o�͒i�Ɋ|���钼���t�B���^
     Filter lpf;                          // �ŏI�o�͂Ɋ|���郍�[�p�X�t�B���^
+    NESOutputFilter nesf;                // NES hardware output model, replaces dcf and lpf (OUTPUT_FILTER=1)
+    EchoUnit echo;                       // optional echo effect (ECHO=1), buffer allocated only while enabled
+    LoudnessMeter loudness;              // measures the rendered output (LOUDNESS=1)
+    WaveformOverview overview;           // min/max/RMS thumbnail of the output (OVERVIEW_MS > 0)
+    ChipPipeline pipeline;               // VRC7, N163 and FDS on worker threads (PIPELINE=1)
+    NES_VRC7 vrc7_state;                 // what the CPU sees of the pipelined chips
+    NES_N106 n106_state;
+    NES_FDS fds_state;
     ILoopDetector *ld;                   // ���[�v���o��
     CPULogger *logcpu;                   // Logs CPU to file
+    Profiler profiler;                   // render timing (NSFPLAY_PROFILE builds only)
+    CPUProfiler profcpu;                 // 6502 hot-spots (NSFPLAY_PROFILE builds with PROFILE_CPU)
 
     // �g���b�N�ԍ��̗�
     enum {
@@ -119,11 +150,13 @@ namespace xgm
 
     /** �Đ����g����ݒ肷�� */
     virtual void SetPlayFreq (double);
+    double GetPlayFreq () const { return rate; }
 
     /**
      * Number of channels to output.
      */
     virtual void SetChannels(int);
+    int GetChannels() const { return nch; }
 
     /** ���Z�b�g����D�O�̉��t�Ńf�[�^�̎��ȏ����������������Ă��Ă��C�����Ȃ��D */
     virtual void Reset ();
@@ -142,6 +175,15 @@ namespace xgm
     /** �����_�����O���s�� */
     virtual UINT32 Render (INT16 * b, UINT32 length);
 
+    /**
+     * Render interleaved float samples, 1.0 = INT16 full scale.
+     * The final filters run at full precision and nothing is clipped.
+     */
+    virtual UINT32 RenderFloat (float * b, UINT32 length);
+
+    /** Render interleaved 24-bit samples in INT32, clipped to 24 bits */
+    virtual UINT32 Render24 (INT32 * b, UINT32 length);
+
     /** �����_�����O���X�L�b�v���� */
     virtual UINT32 Skip (UINT32 length);
 
@@ -169,6 +211,9 @@ namespace xgm
     /** Notify for panning */
     virtual void NotifyPan (int id);
 
+    /** Notify for channel mask, silencing devices with every channel masked */
+    virtual void NotifyMask (int id);
+
     /** time_in_ms���_�ł̃f�o�C�X�����擾���� */
     virtual IDeviceInfo *GetInfo(int time_in_ms, int device_id);
 
@@ -183,6 +228,18 @@ namespace xgm
 
     /** Refresh infinite playback setting from PLAY_ADVANCE config */
     virtual void UpdateInfinite();
+
+    /** Accumulated render profile, empty unless built with NSFPLAY_PROFILE=1 */
+    virtual Profiler& GetProfile();
+
+    /** 6502 cycles by PC and call stack, requires NSFPLAY_PROFILE=1 and PROFILE_CPU config */
+    virtual CPUProfiler& GetCPUProfile();
+
+    /** Loudness and peaks of the output since Reset, requires LOUDNESS config */
+    virtual LoudnessMeter& GetLoudness();
+
+    /** Waveform buckets of the output since Reset, requires OVERVIEW_MS config */
+    virtual WaveformOverview& GetOverview();
   };
 
 }// namespace
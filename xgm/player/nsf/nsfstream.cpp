@@ -0,0 +1,251 @@
+#include <string.h>
+#include <chrono>
+#include "nsfstream.h"
+
+using namespace xgm;
+
+NSFStream::NSFStream(NSFPlayer *p, NSFPlayerConfig *c)
+  : player(p), config(c), commands(64), running(false),
+    epoch(0), finished(~0u), play_pos(0), underruns(0)
+{
+  nch = 1;
+  rate = DEFAULT_RATE;
+  block_frames = DEFAULT_BLOCK;
+  latency_ms = 200;
+  low_ms = 100;
+  high_ms = 0;
+  low_blocks = high_blocks = 1;
+  render_pos = 0;
+  ended = false;
+  filling = false;
+  read_offset = 0;
+}
+
+NSFStream::~NSFStream()
+{
+  Stop();
+}
+
+void NSFStream::SetLatency(UINT32 ms, UINT32 block)
+{
+  if (running.load()) return;
+  latency_ms = ms;
+  block_frames = block ? block : DEFAULT_BLOCK;
+}
+
+void NSFStream::SetWatermarks(UINT32 low, UINT32 high)
+{
+  if (running.load()) return;
+  low_ms = low;
+  high_ms = high;
+}
+
+static UINT32 ms_to_blocks(UINT32 ms, double rate, UINT32 block)
+{
+  return (UINT32)((double(ms) * rate / 1000.0 + block - 1) / block);
+}
+
+bool NSFStream::Start()
+{
+  if (running.load()) return false;
+
+  nch = player->GetChannels();
+  rate = player->GetPlayFreq();
+
+  UINT32 total = ms_to_blocks(latency_ms, rate, block_frames);
+  if (total < 2) total = 2;
+  high_blocks = high_ms ? ms_to_blocks(high_ms, rate, block_frames) : total;
+  if (high_blocks < 1) high_blocks = 1;
+  if (high_blocks > total) high_blocks = total;
+  low_blocks = low_ms ? ms_to_blocks(low_ms, rate, block_frames) : high_blocks;
+  if (low_blocks > high_blocks) low_blocks = high_blocks;
+
+  // every buffer is allocated here, none on either thread
+  ring.Resize(total);
+  for (UINT32 i = 0; i < ring.Capacity(); i++)
+    ring[i].pcm.assign(block_frames * nch, 0);
+  Command c;
+  while (commands.Pop(c)) {}
+
+  render_pos = 0;
+  ended = false;
+  filling = true;
+  read_offset = 0;
+  epoch.store(0);
+  finished.store(~0u);
+  play_pos.store(0);
+  underruns.store(0);
+
+  // the first callback already finds the ring at its high watermark
+  while (!ended && ring.Size() < high_blocks)
+    RenderBlock();
+
+  running.store(true);
+  thread = std::thread(&NSFStream::Run, this);
+  return true;
+}
+
+void NSFStream::Stop()
+{
+  if (!running.load()) return;
+  running.store(false);
+  thread.join();
+}
+
+void NSFStream::RenderBlock()
+{
+  Block &bk = ring.Back();
+  bk.frames = player->Render(&bk.pcm[0], block_frames);
+  bk.epoch = epoch.load(std::memory_order_relaxed);
+  bk.pos = render_pos;
+  bk.last = player->IsStopped();
+  render_pos += bk.frames;
+  ended = bk.last;
+  ring.Push();
+}
+
+void NSFStream::Run()
+{
+  const std::chrono::microseconds nap((long long)(500000.0 * block_frames / rate));
+
+  while (running.load(std::memory_order_relaxed))
+  {
+    Command c;
+    while (commands.Pop(c))
+      Apply(c);
+
+    UINT32 fill = ring.Size();
+    if (fill < low_blocks) filling = true;
+    if (fill >= high_blocks) filling = false;
+
+    if (filling && !ended)
+      RenderBlock();
+    else
+      std::this_thread::sleep_for(nap);
+  }
+}
+
+// Blocks already in the ring are from before the jump; Read drops them.
+void NSFStream::Flush()
+{
+  ended = false;
+  filling = true;
+  epoch.store(epoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void NSFStream::Apply(const Command &c)
+{
+  switch (c.type)
+  {
+  case Command::SEEK:
+    {
+      UINT64 target = (UINT64)((double)(UINT32)c.a * rate / 1000.0);
+      if (target < render_pos)
+      {
+        player->Reset();
+        render_pos = 0;
+      }
+      while (render_pos < target && !player->IsStopped() && running.load(std::memory_order_relaxed))
+      {
+        UINT64 n = target - render_pos;
+        if (n > block_frames) n = block_frames;
+        render_pos += player->Skip((UINT32)n);
+      }
+      Flush();
+    }
+    break;
+  case Command::SONG:
+    player->SetSong(c.a);
+    player->Reset();
+    render_pos = 0;
+    Flush();
+    break;
+  case Command::MASK:
+    (*config)["MASK"] = c.a;
+    player->NotifyMask(-1);
+    break;
+  case Command::PAN:
+    config->GetChannelConfig(c.a, "PAN") = c.b;
+    player->NotifyPan(NSFPlayerConfig::channel_device[c.a]);
+    break;
+  }
+}
+
+UINT32 NSFStream::Read(INT16 *b, UINT32 frames)
+{
+  const UINT32 e = epoch.load(std::memory_order_acquire);
+  UINT32 done = 0;
+
+  while (done < frames && !ring.Empty())
+  {
+    Block &bk = ring.Front();
+    if (bk.epoch != e)
+    {
+      ring.Pop();
+      read_offset = 0;
+      continue;
+    }
+
+    UINT32 n = bk.frames - read_offset;
+    if (n > frames - done) n = frames - done;
+    memcpy(b + done * nch, &bk.pcm[read_offset * nch], n * nch * sizeof(INT16));
+    done += n;
+    read_offset += n;
+    play_pos.store(bk.pos + read_offset, std::memory_order_relaxed);
+
+    if (read_offset >= bk.frames)
+    {
+      bool last = bk.last;
+      ring.Pop();
+      read_offset = 0;
+      if (last)
+      {
+        finished.store(e, std::memory_order_release);
+        break;
+      }
+    }
+  }
+
+  if (done < frames)
+  {
+    memset(b + done * nch, 0, (frames - done) * nch * sizeof(INT16));
+    if (finished.load(std::memory_order_relaxed) != e)
+      underruns.fetch_add(frames - done, std::memory_order_relaxed);
+  }
+  return done;
+}
+
+UINT32 NSFStream::GetBuffered() const
+{
+  return ring.Size() * block_frames;
+}
+
+bool NSFStream::Send(const Command &c)
+{
+  return commands.Push(c);
+}
+
+bool NSFStream::Seek(UINT32 ms)
+{
+  Command c = { Command::SEEK, (int)ms, 0 };
+  return Send(c);
+}
+
+bool NSFStream::SetSong(int s)
+{
+  Command c = { Command::SONG, s, 0 };
+  return Send(c);
+}
+
+bool NSFStream::SetMask(UINT32 mask)
+{
+  Command c = { Command::MASK, (int)mask, 0 };
+  return Send(c);
+}
+
+bool NSFStream::SetPan(int channel, int pan)
+{
+  if (channel < 0 || channel >= NES_CHANNEL_MAX) return false;
+  Command c = { Command::PAN, channel, pan };
+  return Send(c);
+}
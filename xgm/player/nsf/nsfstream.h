@@ -0,0 +1,114 @@
+#ifndef _NSFSTREAM_H_
+#define _NSFSTREAM_H_
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "nsfplay.h"
+#include "../../utils/spsc.h"
+
+namespace xgm
+{
+  // Real-time playback engine: a render thread runs NSFPlayer::Render ahead
+  // of the host into a lock-free ring of PCM blocks, and control commands
+  // reach it through a lock-free queue, applied between blocks. The audio
+  // callback only calls Read, which never blocks, allocates or locks the
+  // vcm configuration. Between Start and Stop the player and its config
+  // belong to the render thread; the host controls them through the
+  // commands below, all sent from one thread.
+  class NSFStream
+  {
+  public:
+    enum { DEFAULT_BLOCK = 512 };  // frames per ring block
+
+  protected:
+    struct Block
+    {
+      std::vector<INT16> pcm;
+      UINT32 frames;
+      UINT32 epoch;      // seeks and song changes since Start
+      UINT64 pos;        // song position of the first frame
+      bool last;         // the player stopped after this block
+    };
+    struct Command
+    {
+      enum { SEEK, SONG, MASK, PAN } type;
+      int a, b;
+    };
+
+    NSFPlayer *player;
+    NSFPlayerConfig *config;
+    int nch;
+    double rate;
+    UINT32 block_frames;
+    UINT32 latency_ms, low_ms, high_ms;
+    UINT32 low_blocks, high_blocks;    // fill levels in blocks, high <= latency
+
+    SPSCQueue<Block> ring;
+    SPSCQueue<Command> commands;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    // render thread
+    UINT64 render_pos;
+    bool ended;
+    bool filling;                      // between the low and high watermark
+
+    // shared
+    std::atomic<UINT32> epoch;         // newest epoch, blocks before it are dropped
+    std::atomic<UINT32> finished;      // epoch whose last block has been read
+    std::atomic<UINT64> play_pos;
+    std::atomic<UINT64> underruns;
+
+    // audio callback
+    UINT32 read_offset;                // frames already taken from Front()
+
+    void Run();
+    void Apply(const Command &c);
+    void RenderBlock();
+    void Flush();
+    bool Send(const Command &c);
+
+  public:
+    NSFStream(NSFPlayer *p, NSFPlayerConfig *c);
+    ~NSFStream();
+
+    /** Ring size, and the block size the render thread works in. Only while stopped. */
+    void SetLatency(UINT32 ms, UINT32 block = DEFAULT_BLOCK);
+    /**
+     * Refill once less than low ms are buffered and stop at high ms.
+     * high 0 = the whole latency, low 0 = refill as soon as a block is free.
+     */
+    void SetWatermarks(UINT32 low, UINT32 high);
+
+    /** Takes the rate and channels already set on the player, fills the ring to the high watermark and starts the thread */
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return running.load(); }
+
+    /**
+     * Audio callback: copies up to frames of interleaved samples and pads
+     * the rest with silence, returns the frames of audio. Never blocks.
+     */
+    UINT32 Read(INT16 *b, UINT32 frames);
+    /** The player stopped and the last block has been read */
+    bool IsFinished() const { return finished.load(std::memory_order_acquire) == epoch.load(std::memory_order_acquire); }
+    /** Song position in frames of the last sample Read */
+    UINT64 GetPosition() const { return play_pos.load(std::memory_order_relaxed); }
+    /** Frames of silence Read had to pad with while the ring was empty */
+    UINT64 GetUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+    /** Frames waiting in the ring */
+    UINT32 GetBuffered() const;
+
+    // Commands for the render thread, false when the queue is full.
+    // Seek and SetSong drop the audio already in the ring.
+    bool Seek(UINT32 ms);
+    bool SetSong(int s);
+    /** MASK config, one bit per channel */
+    bool SetMask(UINT32 mask);
+    /** CHANNEL_xx_PAN config, 0 = left, 128 = centre, 255 = right */
+    bool SetPan(int channel, int pan);
+  };
+
+} // namespace xgm
+
+#endif
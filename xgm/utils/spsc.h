@@ -0,0 +1,76 @@
+#ifndef _SPSC_H_
+#define _SPSC_H_
+#include <atomic>
+#include <vector>
+#include "../xtypes.h"
+
+namespace xgm
+{
+  // Lock-free ring for exactly one producer thread and one consumer thread.
+  // Slots are preallocated and reused, so a slot holding a buffer can be
+  // filled in place: the producer writes Back() and then Push()es it, the
+  // consumer reads Front() and then Pop()s it. Neither side ever blocks.
+  template <class T>
+  class SPSCQueue
+  {
+  protected:
+    std::vector<T> slot;
+    UINT32 mask;
+    // free-running counters, the difference is the fill
+    alignas(64) std::atomic<UINT32> head; // written by the producer
+    alignas(64) std::atomic<UINT32> tail; // written by the consumer
+
+  public:
+    SPSCQueue(UINT32 capacity = 0) : mask(0), head(0), tail(0) { Resize(capacity); }
+
+    // Rounds up to a power of two and empties the queue.
+    // Not safe while either thread is using it.
+    void Resize(UINT32 capacity)
+    {
+      UINT32 n = 1;
+      while (n < capacity) n <<= 1;
+      slot.resize(n);
+      mask = n - 1;
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+    }
+
+    UINT32 Capacity() const { return mask + 1; }
+    UINT32 Size() const
+    {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    bool Empty() const { return Size() == 0; }
+    bool Full() const { return Size() > mask; }
+
+    // all slots, for preallocating buffers before the threads start
+    T& operator[](UINT32 i) { return slot[i]; }
+
+    // producer: the slot Push will publish, valid while !Full()
+    T& Back() { return slot[head.load(std::memory_order_relaxed) & mask]; }
+    void Push() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    bool Push(const T& t)
+    {
+      UINT32 h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) > mask) return false;
+      slot[h & mask] = t;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // consumer: the oldest slot, valid while !Empty()
+    T& Front() { return slot[tail.load(std::memory_order_relaxed) & mask]; }
+    void Pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    bool Pop(T& t)
+    {
+      UINT32 r = tail.load(std::memory_order_relaxed);
+      if (head.load(std::memory_order_acquire) == r) return false;
+      t = slot[r & mask];
+      tail.store(r + 1, std::memory_order_release);
+      return true;
+    }
+  };
+
+} // namespace xgm
+
+#endif